@@ -21,6 +21,9 @@ if [ -z "$3" ]
 fi
 model=$3
 
+# Optional profile, "compact" issues a smaller certificate for an existing key
+profile=$4
+
 cnf_file="cnf/$version/openssl_cert_$model.cnf"
 dir_ca_path="data/$env"
 ca_key_file="$dir_ca_path/ca-priv-key.pem"
@@ -29,18 +32,34 @@ dir_path="data/$env/$version"
 key_file="$dir_path/$model-priv-key.pem"
 cert_file="$dir_path/$model-cert.der"
 
+if [ "$profile" == "compact" ]
+  then
+    cnf_file="cnf/$version/openssl_cert_${model}_compact.cnf"
+    cert_file="$dir_path/$model-compact-cert.der"
+elif [ -n "$profile" ]
+  then
+    echo "Unknown profile <$profile>"
+    exit
+fi
+
 if [ ! -f $cnf_file ]
   then
     echo "File <$cnf_file> not found!"
     exit
 fi
 
-if [ -f $key_file ]
+if [ -z "$profile" ] && [ -f $key_file ]
   then
     echo "File <$key_file> already exist!"
     exit
 fi
 
+if [ -n "$profile" ] && [ ! -f $key_file ]
+  then
+    echo "File <$key_file> not found!"
+    exit
+fi
+
 if [ -f $cert_file ]
   then
     echo "File <$cert_file> already exist!"
@@ -50,11 +69,21 @@ fi
 # Create dir if not present
 mkdir -p $dir_path
 
-# Generate private key
-openssl ecparam -out $key_file -name prime256v1 -genkey
+if [ -z "$profile" ]
+  then
+    # Generate private key
+    openssl ecparam -out $key_file -name prime256v1 -genkey
 
-# Generate associated certificate
-openssl req -new -key $key_file -config $cnf_file |
-openssl x509 -req -CA $ca_cert_file -CAkey $ca_key_file -CAcreateserial \
-        -out $cert_file --outform DER -days 3650 \
-        -extfile $cnf_file -extensions v3_req
+    # Generate associated certificate
+    openssl req -new -key $key_file -config $cnf_file |
+    openssl x509 -req -CA $ca_cert_file -CAkey $ca_key_file -CAcreateserial \
+            -out $cert_file --outform DER -days 3650 \
+            -extfile $cnf_file -extensions v3_req
+else
+    # Generate a certificate for the existing key, with a 4 bytes serial number
+    serial=$((0x$(openssl rand -hex 4) & 0x7fffffff))
+    openssl req -new -key $key_file -config $cnf_file |
+    openssl x509 -req -CA $ca_cert_file -CAkey $ca_key_file -set_serial $serial \
+            -out $cert_file --outform DER -days 3650 \
+            -extfile $cnf_file -extensions v3_req
+fi
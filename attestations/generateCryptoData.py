@@ -1,23 +1,44 @@
 #!/bin/python3
 import argparse
 
+import math
 import os
 import subprocess
+import sys
 
 attestation_key_prefix = "static const uint8_t {}_{}_{}_ATTESTATION_KEY[] ="
 attestation_cert_prefix = "static const uint8_t {}_{}_{}_ATTESTATION_CERT[] ="
 
+# Enroll response without the certificate: reserved byte, public key, v2 key handle
+# length and value, largest DER signature and status word
+ENROLL_RESPONSE_BASE_SIZE = 1 + 65 + 1 + 65 + 72 + 2
+# Payload of the CTAPHID init and continuation packets on a 64 bytes HID report
+CTAPHID_INIT_PAYLOAD_SIZE = 64 - 7
+CTAPHID_CONT_PAYLOAD_SIZE = 64 - 5
+
+
+def enroll_frame_count(cert_size):
+    size = ENROLL_RESPONSE_BASE_SIZE + cert_size
+    if size <= CTAPHID_INIT_PAYLOAD_SIZE:
+        return 1
+    return 1 + math.ceil((size - CTAPHID_INIT_PAYLOAD_SIZE) / CTAPHID_CONT_PAYLOAD_SIZE)
+
 
 parser = argparse.ArgumentParser()
 parser.add_argument('env', type=str, help='CA, key and cert env')
 parser.add_argument('version', type=str, help='target protocol version', choices=["U2F"])
 parser.add_argument('model', type=str, help='device model')
+parser.add_argument('--profile', type=str, help='certificate profile', default="default",
+                    choices=["default", "compact"])
 
 args = parser.parse_args()
 
 files_path = "data/{}/{}/{}-".format(args.env, args.version, args.model)
 key_file = files_path + "priv-key.pem"
 cert_file = files_path + "cert.der"
+default_cert_file = cert_file
+if args.profile == "compact":
+    cert_file = files_path + "compact-cert.der"
 
 env = args.env.upper()
 version = args.version.upper()
@@ -68,3 +89,15 @@ cert_data = ",\n".join(cert_lines)
 cert = attestation_cert_prefix.format(env, version, model) \
       + " {\n" + cert_data + "};"
 print(cert)
+
+# Report the certificate size and its impact on the enroll response, on stderr
+# so that the output above can still be copied as is
+size = len(cert_bytes)
+frames = enroll_frame_count(size)
+report = "{} certificate: {} bytes, {} HID frames per enroll response".format(
+    args.profile, size, frames)
+if cert_file != default_cert_file and os.path.isfile(default_cert_file):
+    default_size = os.path.getsize(default_cert_file)
+    report += " ({:+d} bytes, {:+d} frames vs default)".format(
+        size - default_size, frames - enroll_frame_count(default_size))
+print(report, file=sys.stderr)
@@ -0,0 +1,111 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __CBOR_H__
+#define __CBOR_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Minimal CBOR (RFC 8949) reader and writer, covering what CTAP2 uses:
+ * definite length integers, byte and text strings, arrays, maps and booleans.
+ * Indefinite lengths, tags and floats are rejected by the reader.
+ */
+
+#define CBOR_TYPE_UINT   0
+#define CBOR_TYPE_NINT   1
+#define CBOR_TYPE_BYTES  2
+#define CBOR_TYPE_TEXT   3
+#define CBOR_TYPE_ARRAY  4
+#define CBOR_TYPE_MAP    5
+#define CBOR_TYPE_TAG    6
+#define CBOR_TYPE_SIMPLE 7
+
+// Data is not well-formed, or uses a feature which is not supported
+#define CBOR_ERROR_INVALID -1
+// Data is well-formed but of an unexpected type
+#define CBOR_ERROR_TYPE -2
+
+// Maximum nesting of skipped items, CTAP2 messages are at most 4 levels deep
+#define CBOR_MAX_DEPTH 4
+
+typedef struct cbor_reader_s {
+    const uint8_t *buffer;
+    uint32_t length;
+    uint32_t offset;
+} cbor_reader_t;
+
+typedef struct cbor_writer_s {
+    uint8_t *buffer;
+    uint32_t size;
+    uint32_t offset;
+    // Set when some data did not fit, the content is then truncated
+    bool overflow;
+} cbor_writer_t;
+
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *buffer, uint32_t length);
+
+/**
+ * Return the major type of the next item, or CBOR_ERROR_INVALID at the end of the data.
+ */
+int cbor_peek_type(const cbor_reader_t *reader);
+
+/**
+ * Read the next item, checking its type.
+ * Strings are not copied: a pointer to their content in the reader buffer is returned.
+ * Return 0 on success, CBOR_ERROR_INVALID or CBOR_ERROR_TYPE on error.
+ */
+int cbor_read_int(cbor_reader_t *reader, int32_t *value);
+int cbor_read_bytes(cbor_reader_t *reader, const uint8_t **data, uint32_t *length);
+int cbor_read_text(cbor_reader_t *reader, const char **text, uint32_t *length);
+int cbor_read_array(cbor_reader_t *reader, uint32_t *count);
+int cbor_read_map(cbor_reader_t *reader, uint32_t *count);
+int cbor_read_bool(cbor_reader_t *reader, bool *value);
+
+/**
+ * Skip the next item, including the items it contains.
+ * Return 0 on success, CBOR_ERROR_INVALID on error.
+ */
+int cbor_skip(cbor_reader_t *reader);
+
+/**
+ * Compare a text read with cbor_read_text() to a NUL-terminated string.
+ */
+bool cbor_text_equals(const char *text, uint32_t length, const char *expected);
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buffer, uint32_t size);
+
+/**
+ * Append an item. Integers use the shortest encoding, as required by the CTAP2
+ * canonical form. Map keys must be written in canonical order by the caller.
+ */
+void cbor_write_int(cbor_writer_t *writer, int32_t value);
+void cbor_write_bytes(cbor_writer_t *writer, const uint8_t *data, uint32_t length);
+void cbor_write_text(cbor_writer_t *writer, const char *text);
+void cbor_write_array(cbor_writer_t *writer, uint32_t count);
+void cbor_write_map(cbor_writer_t *writer, uint32_t count);
+void cbor_write_bool(cbor_writer_t *writer, bool value);
+
+/**
+ * Append the header of a byte string whose content is then written in parts
+ * with cbor_write_raw().
+ */
+void cbor_write_bytes_header(cbor_writer_t *writer, uint32_t length);
+void cbor_write_raw(cbor_writer_t *writer, const uint8_t *data, uint32_t length);
+
+#endif
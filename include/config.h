@@ -21,18 +21,52 @@
 
 #define PRIVATE_KEY_PATH 0x80553246  // "U2F".encode("ascii").hex()
 
+#define CONFIG_SEED_FINGERPRINT_SIZE 32
+
 typedef struct config_t {
     uint32_t authentificationCounter;
     uint8_t initialized;
     uint8_t privateHmacKey[64];
+    // Seed cookie of the seed privateHmacKey was derived from
+    uint8_t seedFingerprint[CONFIG_SEED_FINGERPRINT_SIZE];
 } config_t;
 
 extern config_t const N_u2f_real;
 
 #define N_u2f (*(volatile config_t *) PIC(&N_u2f_real))
 
+/**
+ * Check whether the seed changed since privateHmacKey was stored, by comparing
+ * the seed cookie with the persisted fingerprint. Keys are not derived here.
+ */
 void config_init(void);
 
+/**
+ * Derive and store privateHmacKey if it is missing or out of date, together
+ * with the rest of the config record, in a single NVM write.
+ * Must be called before N_u2f content is used.
+ * Return 0 on success, -1 if the derivation failed.
+ */
+int config_ensure_keys(void);
+
+/**
+ * The authentication counter is persisted once every CONFIG_COUNTER_WINDOW
+ * increments: NVM holds the highest value that may have been returned, and
+ * increments below this mark are served from RAM. After a reboot or an IO
+ * reset, counting restarts above the persisted mark, so the counter is
+ * always increasing, possibly skipping up to CONFIG_COUNTER_WINDOW values.
+ */
+#define CONFIG_COUNTER_WINDOW 32
+
+/**
+ * Write the next authentication counter value in buffer.
+ * Return its length, or 0 if the config record could not be initialized.
+ */
 uint8_t config_increase_and_get_authentification_counter(uint8_t *buffer);
 
+/**
+ * Return the number of counter increments served without a NVM write.
+ */
+uint32_t config_get_counter_saved_writes(void);
+
 #endif
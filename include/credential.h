@@ -23,14 +23,51 @@
 #define CREDENTIAL_PRIVATE_KEY_SIZE CX_SHA256_SIZE
 #define CREDENTIAL_SIGNATURE_SIZE   CX_SHA256_SIZE
 
-#define CREDENTIAL_MINIMAL_SIZE (CREDENTIAL_NONCE_SIZE + CREDENTIAL_SIGNATURE_SIZE)
+/* Legacy v1 credential, no longer generated but still accepted:
+ *
+ * +-------+------------------------------------+
+ * | Nonce | HMAC(rpIdHash | private key)       |
+ * +-------+------------------------------------+
+ * | 32 B  | 32 B                               |
+ * +-------+------------------------------------+
+ */
+#define CREDENTIAL_V1_SIZE (CREDENTIAL_NONCE_SIZE + CREDENTIAL_SIGNATURE_SIZE)
+
+/* v2 credential, whose signature can be checked without deriving the private key:
+ *
+ * +---------+-------+------------------------------------+
+ * | Version | Nonce | HMAC(version | nonce | rpIdHash)   |
+ * +---------+-------+------------------------------------+
+ * | 1 B     | 32 B  | 32 B                               |
+ * +---------+-------+------------------------------------+
+ */
+#define CREDENTIAL_VERSION_2 0x02
+#define CREDENTIAL_V2_SIZE   (1 + CREDENTIAL_NONCE_SIZE + CREDENTIAL_SIGNATURE_SIZE)
+
+/* Compact credential, same as v2 with a shorter nonce and a truncated signature,
+ * so that an U2F authentication request fits in two CTAPHID packets:
+ *
+ * +---------+-------+------------------------------------------------+
+ * | Version | Nonce | HMAC(version | nonce | rpIdHash) truncated     |
+ * +---------+-------+------------------------------------------------+
+ * | 1 B     | 16 B  | 16 B                                           |
+ * +---------+-------+------------------------------------------------+
+ */
+#define CREDENTIAL_VERSION_COMPACT        0x03
+#define CREDENTIAL_COMPACT_NONCE_SIZE     16
+#define CREDENTIAL_COMPACT_SIGNATURE_SIZE 16
+#define CREDENTIAL_COMPACT_SIZE \
+    (1 + CREDENTIAL_COMPACT_NONCE_SIZE + CREDENTIAL_COMPACT_SIGNATURE_SIZE)
+
+#define CREDENTIAL_MAX_SIZE CREDENTIAL_V2_SIZE
 
 /**
  * Wrap credential to be sent to platform:
  * inputs:
  *  - rpIdHash (or application parameter in U2F)
- *  - the random nonce to be associated to this credential
- *  - the private key associated to this credential
+ *  - the random nonce to be associated to this credential and its length:
+ *    CREDENTIAL_NONCE_SIZE for a v2 credential,
+ *    CREDENTIAL_COMPACT_NONCE_SIZE for a compact credential
  *
  * outputs:
  * - credId will be stored in buffer
@@ -41,12 +78,12 @@
  */
 int credential_wrap(const uint8_t *rpIdHash,
                     const uint8_t *nonce,
-                    const cx_ecfp_private_key_t *private_key,
+                    uint8_t nonceLen,
                     uint8_t *buffer,
                     uint32_t bufferLen);
 
 /**
- * Check and unwrap credential from credId received from platform:
+ * Check and unwrap credential (v1, v2 or compact) from credId received from platform:
  * inputs:
  *  - rpIdHash (or application parameter in U2F)
  *  - credId and credIdLen
@@ -55,7 +92,7 @@ int credential_wrap(const uint8_t *rpIdHash,
  * - the random nonce to associated to this credential
  *
  * Return:
- * - == 0 if everything went fine
+ * - > 0 the length of the nonce if everything went fine
  * - < 0 an error occurred (wrong size, wrong signature, ...)
  */
 int credential_unwrap(const uint8_t *rpIdHash,
@@ -63,4 +100,37 @@ int credential_unwrap(const uint8_t *rpIdHash,
                       uint32_t credIdLen,
                       uint8_t **nonce);
 
+/* Cache of the v1 credentials recently validated by credential_unwrap(), so
+ * that the usual check-only then sign sequence only derives their key once.
+ * Entries are identified by SHA-256(rpIdHash | credId) truncated, and expire
+ * after CREDENTIAL_CACHE_LIFETIME_TICKS ticker events.
+ */
+#define CREDENTIAL_CACHE_ENTRIES        4
+#define CREDENTIAL_CACHE_DIGEST_SIZE    16
+#define CREDENTIAL_CACHE_LIFETIME_TICKS 50  // about 5 seconds
+
+typedef struct credential_cache_entry_s {
+    uint8_t digest[CREDENTIAL_CACHE_DIGEST_SIZE];
+    uint32_t timestamp;
+    bool used;
+} credential_cache_entry_t;
+
+typedef struct credential_cache_s {
+    credential_cache_entry_t entries[CREDENTIAL_CACHE_ENTRIES];
+    uint8_t next;
+    uint32_t hits;
+    uint32_t misses;
+} credential_cache_t;
+
+/**
+ * Drop all cached credentials. Hit and miss counters are kept.
+ */
+void credential_cache_reset(void);
+
+/**
+ * Retrieve the number of credential_unwrap() calls that were served from the
+ * cache (hits) or needed the signature to be computed (misses).
+ */
+void credential_cache_get_stats(uint32_t *hits, uint32_t *misses);
+
 #endif
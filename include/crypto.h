@@ -19,16 +19,43 @@
 #ifndef __CRYPTO_H__
 #define __CRYPTO_H__
 
+// DER encoded ECDSA signature over a 256 bits curve
+#define CRYPTO_SIGNATURE_MAX_SIZE 72
+
 /**
  * Compare two buffer a and b.
  * Return true if they match, else false.
  */
 bool crypto_compare(const uint8_t *a, const uint8_t *b, uint16_t length);
 
+/**
+ * Drop the HMAC-SHA256 inner and outer midstates of the privateHmacKey.
+ * They are computed again on next crypto_hmac_init(), once privateHmacKey is
+ * up to date. Must be called each time privateHmacKey may have changed.
+ */
+void crypto_reset_hmac_key(void);
+
+/**
+ * Start a HMAC-SHA256 keyed with privateHmacKey, cloning the precomputed inner midstate.
+ */
+cx_err_t crypto_hmac_init(cx_sha256_t *hmac_ctx);
+
+/**
+ * Add data to a HMAC-SHA256 started with crypto_hmac_init().
+ */
+cx_err_t crypto_hmac_update(cx_sha256_t *hmac_ctx, const uint8_t *data, size_t length);
+
+/**
+ * Finalize a HMAC-SHA256 started with crypto_hmac_init() and store the 32 bytes MAC.
+ * hmac_ctx is wiped before returning, even on error.
+ */
+cx_err_t crypto_hmac_final(cx_sha256_t *hmac_ctx, uint8_t *mac);
+
 /**
  * Generate private key for specific curve from nonce.
  */
 int crypto_generate_private_key(const uint8_t *nonce,
+                                uint8_t nonce_length,
                                 cx_ecfp_private_key_t *private_key,
                                 cx_curve_t curve);
 
@@ -39,6 +66,22 @@ int crypto_generate_public_key(cx_ecfp_private_key_t *private_key,
                                uint8_t *public_key,
                                cx_curve_t curve);
 
+/**
+ * Compute one more ECDSA presignature if the pool is not full.
+ * Called while the app is idle, so that signing only has to do modular arithmetic.
+ */
+void crypto_presignature_pool_refill(void);
+
+/**
+ * Wipe all the presignatures of the pool.
+ */
+void crypto_presignature_pool_reset(void);
+
+/**
+ * Get the number of signatures made with a presignature (hits) and without (misses).
+ */
+void crypto_presignature_get_stats(uint32_t *hits, uint32_t *misses);
+
 /**
  * Sign data_hash with private_key and store it in signature.
  * Return the length of the signature.
@@ -53,4 +96,15 @@ int crypto_sign_application(const uint8_t *data_hash,
  */
 int crypto_sign_attestation(const uint8_t *data_hash, uint8_t *signature);
 
+#ifdef HAVE_KNOWN_APPS_NVM
+/**
+ * Verify the DER encoded signature of a known apps directory hash with the
+ * known apps public key.
+ * Return true if the signature is valid, else false.
+ */
+bool crypto_verify_known_apps(const uint8_t *data_hash,
+                              const uint8_t *signature,
+                              size_t signature_length);
+#endif
+
 #endif
@@ -55,36 +55,29 @@ static const uint8_t TEST_U2F_NANOS_ATTESTATION_KEY[] = {
     0x6d, 0x14, 0x03, 0x72, 0x31, 0x91, 0x3f, 0xf4, 0x04, 0x0d, 0x9a, 0xcb, 0xac, 0xeb, 0x78, 0x73,
     0xe6, 0x00, 0x12, 0x97, 0x96, 0x50, 0x7c, 0x44, 0x54, 0xba, 0x30, 0x85, 0x75, 0x47, 0x31, 0x33};
 static const uint8_t TEST_U2F_NANOS_ATTESTATION_CERT[] = {
-    0x30, 0x82, 0x01, 0xce, 0x30, 0x82, 0x01, 0x74, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x0c,
-    0x20, 0x10, 0x9d, 0x50, 0xe9, 0xa0, 0x63, 0x59, 0xa6, 0xf1, 0x03, 0xe4, 0x83, 0x5e, 0xbb, 0xd5,
-    0x3b, 0x10, 0xc4, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x30, 0x82, 0x01, 0x68, 0x30, 0x82, 0x01, 0x0e, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x04, 0x13,
+    0xfd, 0x08, 0x6b, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
     0x43, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x46, 0x52, 0x31, 0x0f,
     0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x31,
     0x23, 0x30, 0x21, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x1a, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72,
     0x20, 0x46, 0x49, 0x44, 0x4f, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f,
-    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x32, 0x30, 0x39, 0x32, 0x36, 0x30, 0x38,
-    0x30, 0x35, 0x34, 0x39, 0x5a, 0x17, 0x0d, 0x33, 0x32, 0x30, 0x39, 0x32, 0x33, 0x30, 0x38, 0x30,
-    0x35, 0x34, 0x39, 0x5a, 0x30, 0x72, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13,
-    0x02, 0x46, 0x52, 0x31, 0x0f, 0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65,
-    0x64, 0x67, 0x65, 0x72, 0x31, 0x22, 0x30, 0x20, 0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x19, 0x41,
-    0x75, 0x74, 0x68, 0x65, 0x6e, 0x74, 0x69, 0x63, 0x61, 0x74, 0x6f, 0x72, 0x20, 0x41, 0x74, 0x74,
-    0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x31, 0x2e, 0x30, 0x2c, 0x06, 0x03, 0x55, 0x04,
-    0x03, 0x0c, 0x25, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x53,
-    0x20, 0x55, 0x32, 0x46, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e,
-    0x20, 0x42, 0x61, 0x74, 0x63, 0x68, 0x20, 0x31, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86,
-    0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03,
-    0x42, 0x00, 0x04, 0xbf, 0x8a, 0x5d, 0x36, 0x88, 0x7d, 0x1d, 0x76, 0xce, 0x60, 0x5d, 0x36, 0xd9,
-    0x93, 0xaf, 0x59, 0xe5, 0x71, 0xb3, 0x08, 0x10, 0xc4, 0x18, 0x2c, 0x06, 0x68, 0x94, 0xb4, 0x57,
-    0x8f, 0x7a, 0x1d, 0xeb, 0xa0, 0xb7, 0xb0, 0xc2, 0xa6, 0x06, 0x68, 0x12, 0x44, 0x07, 0x60, 0xd3,
-    0xb7, 0xc0, 0x3c, 0x7b, 0xb5, 0xe9, 0xa2, 0xfa, 0xbe, 0xad, 0x60, 0x84, 0x6f, 0x88, 0x9a, 0x2a,
-    0x9f, 0x62, 0x2a, 0xa3, 0x17, 0x30, 0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01,
-    0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01, 0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08,
-    0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x20, 0x64,
-    0xbb, 0xe2, 0xae, 0x2e, 0x4c, 0x59, 0xf8, 0x69, 0xcd, 0x61, 0xc1, 0xf1, 0xea, 0x3f, 0x71, 0xb6,
-    0x8a, 0x36, 0x64, 0xdd, 0x7b, 0x3f, 0xd0, 0xe6, 0x21, 0x8e, 0x57, 0xa6, 0x66, 0xfd, 0xe6, 0x02,
-    0x21, 0x00, 0xc3, 0xaf, 0xb5, 0x42, 0xaa, 0x3d, 0xb2, 0x84, 0xb2, 0x1e, 0x26, 0x9c, 0xc9, 0x73,
-    0x1d, 0x4b, 0x40, 0x2f, 0x4f, 0xb6, 0x3d, 0x08, 0xc6, 0x32, 0x69, 0xcc, 0xf2, 0x18, 0x08, 0xa3,
-    0xdb, 0xfb};
+    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30, 0x30,
+    0x35, 0x39, 0x31, 0x39, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x34, 0x30, 0x30, 0x35,
+    0x39, 0x31, 0x39, 0x5a, 0x30, 0x1c, 0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c,
+    0x11, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x53, 0x20, 0x55,
+    0x32, 0x46, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06,
+    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xbf, 0x8a, 0x5d,
+    0x36, 0x88, 0x7d, 0x1d, 0x76, 0xce, 0x60, 0x5d, 0x36, 0xd9, 0x93, 0xaf, 0x59, 0xe5, 0x71, 0xb3,
+    0x08, 0x10, 0xc4, 0x18, 0x2c, 0x06, 0x68, 0x94, 0xb4, 0x57, 0x8f, 0x7a, 0x1d, 0xeb, 0xa0, 0xb7,
+    0xb0, 0xc2, 0xa6, 0x06, 0x68, 0x12, 0x44, 0x07, 0x60, 0xd3, 0xb7, 0xc0, 0x3c, 0x7b, 0xb5, 0xe9,
+    0xa2, 0xfa, 0xbe, 0xad, 0x60, 0x84, 0x6f, 0x88, 0x9a, 0x2a, 0x9f, 0x62, 0x2a, 0xa3, 0x17, 0x30,
+    0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01,
+    0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04,
+    0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x20, 0x0c, 0xf3, 0xa3, 0x1f, 0x36, 0x88, 0x9d,
+    0x7d, 0xa5, 0xb7, 0x93, 0x45, 0x35, 0xae, 0x7f, 0x71, 0x6f, 0x33, 0x1c, 0x86, 0x57, 0xcb, 0x4e,
+    0x37, 0x8b, 0x0c, 0x1d, 0xf5, 0x81, 0xd2, 0x30, 0xcd, 0x02, 0x21, 0x00, 0xaf, 0x72, 0x40, 0x08,
+    0x37, 0x75, 0x3e, 0xeb, 0x9b, 0x54, 0x58, 0x4e, 0xb2, 0x45, 0x90, 0x59, 0x7f, 0xb4, 0xde, 0x67,
+    0x78, 0xb1, 0xa5, 0xe7, 0x01, 0xe5, 0x00, 0x1e, 0x8c, 0x4a, 0xff, 0x03};
 
 /******************************************/
 /*             NANOX TARGET               */
@@ -125,36 +118,29 @@ static const uint8_t TEST_U2F_NANOX_ATTESTATION_KEY[] = {
     0xd6, 0xd5, 0x92, 0x55, 0x7b, 0xe4, 0x07, 0x8d, 0xe3, 0x2b, 0x3d, 0x86, 0x91, 0x85, 0xce, 0x8a,
     0x5e, 0x32, 0xd2, 0x5d, 0x11, 0xd6, 0xa3, 0x05, 0x1e, 0xc5, 0x90, 0x48, 0xb0, 0x9b, 0x99, 0xec};
 static const uint8_t TEST_U2F_NANOX_ATTESTATION_CERT[] = {
-    0x30, 0x82, 0x01, 0xce, 0x30, 0x82, 0x01, 0x74, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x0c,
-    0x20, 0x10, 0x9d, 0x50, 0xe9, 0xa0, 0x63, 0x59, 0xa6, 0xf1, 0x03, 0xe4, 0x83, 0x5e, 0xbb, 0xd5,
-    0x3b, 0x10, 0xc5, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x30, 0x82, 0x01, 0x68, 0x30, 0x82, 0x01, 0x0e, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x04, 0x79,
+    0x95, 0x4e, 0x7a, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
     0x43, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x46, 0x52, 0x31, 0x0f,
     0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x31,
     0x23, 0x30, 0x21, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x1a, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72,
     0x20, 0x46, 0x49, 0x44, 0x4f, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f,
-    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x32, 0x30, 0x39, 0x32, 0x36, 0x30, 0x38,
-    0x30, 0x35, 0x35, 0x31, 0x5a, 0x17, 0x0d, 0x33, 0x32, 0x30, 0x39, 0x32, 0x33, 0x30, 0x38, 0x30,
-    0x35, 0x35, 0x31, 0x5a, 0x30, 0x72, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13,
-    0x02, 0x46, 0x52, 0x31, 0x0f, 0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65,
-    0x64, 0x67, 0x65, 0x72, 0x31, 0x22, 0x30, 0x20, 0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x19, 0x41,
-    0x75, 0x74, 0x68, 0x65, 0x6e, 0x74, 0x69, 0x63, 0x61, 0x74, 0x6f, 0x72, 0x20, 0x41, 0x74, 0x74,
-    0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x31, 0x2e, 0x30, 0x2c, 0x06, 0x03, 0x55, 0x04,
-    0x03, 0x0c, 0x25, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x58,
-    0x20, 0x55, 0x32, 0x46, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e,
-    0x20, 0x42, 0x61, 0x74, 0x63, 0x68, 0x20, 0x31, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86,
-    0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03,
-    0x42, 0x00, 0x04, 0x5f, 0xb1, 0xf8, 0xae, 0xda, 0xb4, 0xe0, 0xe2, 0x82, 0xae, 0xc9, 0x21, 0x4f,
-    0x58, 0x34, 0x8b, 0xef, 0x28, 0xe2, 0x41, 0xff, 0xf1, 0x4a, 0x7e, 0x37, 0x9b, 0x87, 0xfa, 0xea,
-    0xfe, 0x26, 0x99, 0x0e, 0xbf, 0xc3, 0xb7, 0xdd, 0x94, 0x26, 0x0c, 0xf9, 0x7c, 0xf3, 0xd1, 0x4f,
-    0x3b, 0xb1, 0xf2, 0x4d, 0x6e, 0x59, 0x1c, 0x02, 0xd0, 0xf7, 0x0a, 0xb8, 0x96, 0x73, 0x85, 0x8e,
-    0x0f, 0x59, 0xe2, 0xa3, 0x17, 0x30, 0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01,
-    0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01, 0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08,
-    0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x20, 0x4d,
-    0xb5, 0x1e, 0x08, 0x4f, 0x68, 0x87, 0x53, 0x19, 0xa3, 0x99, 0x42, 0x40, 0x19, 0x4f, 0x37, 0x53,
-    0x4d, 0x7f, 0x16, 0x67, 0x19, 0xf5, 0xc8, 0xec, 0x93, 0xcd, 0x98, 0x94, 0x5d, 0xbe, 0xde, 0x02,
-    0x21, 0x00, 0xff, 0xfa, 0x70, 0xe1, 0xc7, 0x50, 0xe1, 0xaf, 0x5c, 0x97, 0xe6, 0x4a, 0x63, 0xd7,
-    0x14, 0x78, 0x70, 0xf2, 0x22, 0xeb, 0x42, 0x6c, 0x0b, 0x1d, 0x4c, 0xa3, 0x79, 0x18, 0xf3, 0x17,
-    0x65, 0xde};
+    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30, 0x30,
+    0x35, 0x39, 0x31, 0x39, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x34, 0x30, 0x30, 0x35,
+    0x39, 0x31, 0x39, 0x5a, 0x30, 0x1c, 0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c,
+    0x11, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x58, 0x20, 0x55,
+    0x32, 0x46, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06,
+    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0x5f, 0xb1, 0xf8,
+    0xae, 0xda, 0xb4, 0xe0, 0xe2, 0x82, 0xae, 0xc9, 0x21, 0x4f, 0x58, 0x34, 0x8b, 0xef, 0x28, 0xe2,
+    0x41, 0xff, 0xf1, 0x4a, 0x7e, 0x37, 0x9b, 0x87, 0xfa, 0xea, 0xfe, 0x26, 0x99, 0x0e, 0xbf, 0xc3,
+    0xb7, 0xdd, 0x94, 0x26, 0x0c, 0xf9, 0x7c, 0xf3, 0xd1, 0x4f, 0x3b, 0xb1, 0xf2, 0x4d, 0x6e, 0x59,
+    0x1c, 0x02, 0xd0, 0xf7, 0x0a, 0xb8, 0x96, 0x73, 0x85, 0x8e, 0x0f, 0x59, 0xe2, 0xa3, 0x17, 0x30,
+    0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01,
+    0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04,
+    0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x21, 0x00, 0x8f, 0x08, 0x18, 0x45, 0x0d, 0x52,
+    0x69, 0x21, 0x31, 0x47, 0x2a, 0x89, 0x47, 0x62, 0x9d, 0x8f, 0x10, 0xc2, 0x58, 0x03, 0x7b, 0x50,
+    0xa4, 0xd1, 0x85, 0x6d, 0x1c, 0x77, 0xd3, 0xaf, 0xed, 0xb4, 0x02, 0x20, 0x61, 0x09, 0xc0, 0xeb,
+    0x09, 0xbf, 0x48, 0x27, 0x90, 0xb7, 0xee, 0x2f, 0x19, 0x04, 0xc2, 0x7f, 0xc3, 0x52, 0x64, 0x79,
+    0x72, 0x3d, 0xe7, 0xdd, 0xbd, 0x78, 0xe6, 0x06, 0x6f, 0x23, 0x7a, 0x51};
 
 /******************************************/
 /*            NANOSP TARGET               */
@@ -194,36 +180,29 @@ static const uint8_t TEST_U2F_NANOSP_ATTESTATION_KEY[] = {
     0xbf, 0x30, 0x64, 0x3c, 0xa8, 0x92, 0x52, 0xa0, 0x7f, 0xa8, 0x9b, 0x94, 0x5f, 0x6c, 0xf8, 0xda,
     0xcb, 0xfe, 0x33, 0xfa, 0xc1, 0x58, 0xc1, 0x06, 0x61, 0x46, 0x61, 0x92, 0x39, 0x56, 0x08, 0x28};
 static const uint8_t TEST_U2F_NANOSP_ATTESTATION_CERT[] = {
-    0x30, 0x82, 0x01, 0xcf, 0x30, 0x82, 0x01, 0x75, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x0c,
-    0x20, 0x10, 0x9d, 0x50, 0xe9, 0xa0, 0x63, 0x59, 0xa6, 0xf1, 0x03, 0xe4, 0x83, 0x5e, 0xbb, 0xd5,
-    0x3b, 0x10, 0xc6, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x30, 0x82, 0x01, 0x68, 0x30, 0x82, 0x01, 0x0f, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x04, 0x57,
+    0xac, 0xc7, 0x3f, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
     0x43, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x46, 0x52, 0x31, 0x0f,
     0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x31,
     0x23, 0x30, 0x21, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x1a, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72,
     0x20, 0x46, 0x49, 0x44, 0x4f, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f,
-    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x32, 0x30, 0x39, 0x32, 0x36, 0x30, 0x38,
-    0x30, 0x35, 0x35, 0x35, 0x5a, 0x17, 0x0d, 0x33, 0x32, 0x30, 0x39, 0x32, 0x33, 0x30, 0x38, 0x30,
-    0x35, 0x35, 0x35, 0x5a, 0x30, 0x73, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13,
-    0x02, 0x46, 0x52, 0x31, 0x0f, 0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65,
-    0x64, 0x67, 0x65, 0x72, 0x31, 0x22, 0x30, 0x20, 0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x19, 0x41,
-    0x75, 0x74, 0x68, 0x65, 0x6e, 0x74, 0x69, 0x63, 0x61, 0x74, 0x6f, 0x72, 0x20, 0x41, 0x74, 0x74,
-    0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x31, 0x2f, 0x30, 0x2d, 0x06, 0x03, 0x55, 0x04,
-    0x03, 0x0c, 0x26, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x53,
-    0x50, 0x20, 0x55, 0x32, 0x46, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f,
-    0x6e, 0x20, 0x42, 0x61, 0x74, 0x63, 0x68, 0x20, 0x31, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a,
-    0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07,
-    0x03, 0x42, 0x00, 0x04, 0x48, 0xc6, 0xea, 0xc2, 0x9e, 0x2a, 0x66, 0xad, 0x15, 0xf8, 0x33, 0x3e,
-    0xdf, 0x5a, 0x76, 0xa0, 0x65, 0x00, 0x68, 0xb6, 0x79, 0x05, 0x8f, 0x63, 0x9d, 0x0b, 0x84, 0xec,
-    0x87, 0x18, 0x42, 0xf0, 0xab, 0xa7, 0xcf, 0xdc, 0x93, 0x25, 0x88, 0x94, 0x70, 0xde, 0xd0, 0x3b,
-    0x16, 0x76, 0x19, 0x69, 0x50, 0x36, 0x10, 0x92, 0x59, 0x72, 0x2a, 0x54, 0xeb, 0xb3, 0x24, 0x1f,
-    0x1a, 0xd0, 0x61, 0x92, 0xa3, 0x17, 0x30, 0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04,
-    0x01, 0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01, 0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06,
-    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x21,
-    0x00, 0xef, 0xec, 0xe9, 0x03, 0x58, 0xf9, 0x91, 0x42, 0x8a, 0xe0, 0x22, 0x94, 0x49, 0xbd, 0x28,
-    0xaa, 0x06, 0x35, 0x2f, 0x0b, 0xb0, 0x54, 0xef, 0xd9, 0x57, 0x4c, 0x5e, 0x8d, 0x92, 0xd9, 0xec,
-    0x30, 0x02, 0x20, 0x2c, 0xa8, 0xbe, 0xf5, 0x0e, 0x11, 0xf2, 0xc7, 0xd4, 0x9d, 0xe3, 0x74, 0x49,
-    0xd7, 0x80, 0xd4, 0x36, 0x99, 0x8b, 0x32, 0x64, 0x0d, 0xbf, 0x4f, 0xd1, 0x63, 0xc7, 0x09, 0x85,
-    0x75, 0x95, 0x57};
+    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30, 0x30,
+    0x35, 0x39, 0x31, 0x39, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x34, 0x30, 0x30, 0x35,
+    0x39, 0x31, 0x39, 0x5a, 0x30, 0x1d, 0x31, 0x1b, 0x30, 0x19, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c,
+    0x12, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x4e, 0x61, 0x6e, 0x6f, 0x2d, 0x53, 0x50, 0x20,
+    0x55, 0x32, 0x46, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01,
+    0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0x48, 0xc6,
+    0xea, 0xc2, 0x9e, 0x2a, 0x66, 0xad, 0x15, 0xf8, 0x33, 0x3e, 0xdf, 0x5a, 0x76, 0xa0, 0x65, 0x00,
+    0x68, 0xb6, 0x79, 0x05, 0x8f, 0x63, 0x9d, 0x0b, 0x84, 0xec, 0x87, 0x18, 0x42, 0xf0, 0xab, 0xa7,
+    0xcf, 0xdc, 0x93, 0x25, 0x88, 0x94, 0x70, 0xde, 0xd0, 0x3b, 0x16, 0x76, 0x19, 0x69, 0x50, 0x36,
+    0x10, 0x92, 0x59, 0x72, 0x2a, 0x54, 0xeb, 0xb3, 0x24, 0x1f, 0x1a, 0xd0, 0x61, 0x92, 0xa3, 0x17,
+    0x30, 0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0xe5, 0x1c, 0x02, 0x01,
+    0x01, 0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d,
+    0x04, 0x03, 0x02, 0x03, 0x47, 0x00, 0x30, 0x44, 0x02, 0x20, 0x7d, 0x9d, 0x77, 0x93, 0x24, 0x03,
+    0xdc, 0xe8, 0xb7, 0x12, 0x2f, 0xbe, 0x03, 0xf8, 0x37, 0xb0, 0xa7, 0xc2, 0xa1, 0x30, 0x78, 0x5a,
+    0xfb, 0x43, 0x5f, 0x2a, 0xbb, 0x6e, 0x64, 0xb3, 0xf1, 0x67, 0x02, 0x20, 0x74, 0x50, 0xa0, 0xe5,
+    0xa6, 0xe2, 0xe1, 0xfe, 0xec, 0x70, 0x01, 0x6d, 0xc7, 0x14, 0xa3, 0x58, 0xe1, 0x5b, 0xab, 0x57,
+    0xb0, 0x98, 0xb3, 0x84, 0x0a, 0xcb, 0x9c, 0x19, 0xa1, 0xf4, 0xb8, 0x21};
 
 /******************************************/
 /*              STAX TARGET               */
@@ -269,35 +248,29 @@ static const uint8_t TEST_U2F_STAX_ATTESTATION_KEY[] = {
     0x7a, 0xff, 0x17, 0x1b, 0x9d, 0x24, 0xe9, 0xdf, 0x6c, 0xb2, 0x25, 0x97, 0x20, 0x8f, 0x68, 0xbb,
     0xe4, 0x72, 0xca, 0x07, 0x83, 0xa1, 0x9d, 0x34, 0xb7, 0x5a, 0xa0, 0x18, 0xe9, 0x7a, 0x2f, 0x68};
 static const uint8_t TEST_U2F_STAX_ATTESTATION_CERT[] = {
-    0x30, 0x82, 0x01, 0xcc, 0x30, 0x82, 0x01, 0x72, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x0c,
-    0x20, 0x10, 0x9d, 0x50, 0xe9, 0xa0, 0x63, 0x59, 0xa6, 0xf1, 0x03, 0xe4, 0x83, 0x5e, 0xbb, 0xd5,
-    0x3b, 0x10, 0xcb, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x30, 0x82, 0x01, 0x66, 0x30, 0x82, 0x01, 0x0c, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x04, 0x74,
+    0x58, 0x36, 0x0e, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
     0x43, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x46, 0x52, 0x31, 0x0f,
     0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x31,
     0x23, 0x30, 0x21, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x1a, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72,
     0x20, 0x46, 0x49, 0x44, 0x4f, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f,
-    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x33, 0x30, 0x31, 0x32, 0x30, 0x31, 0x35,
-    0x30, 0x37, 0x35, 0x36, 0x5a, 0x17, 0x0d, 0x33, 0x33, 0x30, 0x31, 0x31, 0x37, 0x31, 0x35, 0x30,
-    0x37, 0x35, 0x36, 0x5a, 0x30, 0x70, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13,
-    0x02, 0x46, 0x52, 0x31, 0x0f, 0x30, 0x0d, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x06, 0x4c, 0x65,
-    0x64, 0x67, 0x65, 0x72, 0x31, 0x22, 0x30, 0x20, 0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x19, 0x41,
-    0x75, 0x74, 0x68, 0x65, 0x6e, 0x74, 0x69, 0x63, 0x61, 0x74, 0x6f, 0x72, 0x20, 0x41, 0x74, 0x74,
-    0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x31, 0x2c, 0x30, 0x2a, 0x06, 0x03, 0x55, 0x04,
-    0x03, 0x0c, 0x23, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x53, 0x74, 0x61, 0x78, 0x20, 0x55,
-    0x32, 0x46, 0x20, 0x41, 0x74, 0x74, 0x65, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x42,
-    0x61, 0x74, 0x63, 0x68, 0x20, 0x31, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce,
-    0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00,
-    0x04, 0xe3, 0xaa, 0xc8, 0x51, 0x7d, 0x19, 0xbe, 0x77, 0x35, 0xc1, 0xd2, 0x73, 0x46, 0x5d, 0xad,
-    0x94, 0x04, 0xbc, 0x12, 0x38, 0x07, 0xef, 0xbb, 0x76, 0x63, 0x80, 0xd5, 0xc4, 0xd2, 0x68, 0xc4,
-    0x44, 0xa6, 0x78, 0x65, 0x8a, 0xab, 0x5d, 0xcd, 0x07, 0xd4, 0x9f, 0xb1, 0xe6, 0x83, 0xab, 0x96,
-    0xd6, 0xcf, 0x04, 0x2f, 0x53, 0x4c, 0x8c, 0xbc, 0x4c, 0x33, 0x36, 0xf7, 0x49, 0x9d, 0x2a, 0xb6,
-    0xf4, 0xa3, 0x17, 0x30, 0x15, 0x30, 0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0xe5,
-    0x1c, 0x02, 0x01, 0x01, 0x04, 0x04, 0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86,
-    0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x21, 0x00, 0xbb, 0x42,
-    0x8e, 0x94, 0x5a, 0x41, 0x91, 0x13, 0x0e, 0xb9, 0xe7, 0x60, 0x85, 0x03, 0xae, 0x6e, 0x4b, 0x87,
-    0x94, 0xd6, 0xd9, 0xba, 0x49, 0x78, 0x95, 0xa8, 0x4d, 0x73, 0x26, 0x66, 0xe7, 0xe8, 0x02, 0x20,
-    0x17, 0x0b, 0x87, 0xb6, 0x59, 0xd9, 0x81, 0x95, 0x53, 0x26, 0x26, 0xc9, 0xe3, 0xa9, 0x94, 0x3a,
-    0xdf, 0x4f, 0xe9, 0x50, 0x39, 0x05, 0xa0, 0xf2, 0x1f, 0xa0, 0x72, 0x98, 0x33, 0x19, 0xd6, 0xbd};
+    0x6e, 0x20, 0x43, 0x41, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30, 0x30,
+    0x35, 0x39, 0x31, 0x39, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x34, 0x30, 0x30, 0x35,
+    0x39, 0x31, 0x39, 0x5a, 0x30, 0x1a, 0x31, 0x18, 0x30, 0x16, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c,
+    0x0f, 0x4c, 0x65, 0x64, 0x67, 0x65, 0x72, 0x20, 0x53, 0x74, 0x61, 0x78, 0x20, 0x55, 0x32, 0x46,
+    0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a,
+    0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xe3, 0xaa, 0xc8, 0x51, 0x7d,
+    0x19, 0xbe, 0x77, 0x35, 0xc1, 0xd2, 0x73, 0x46, 0x5d, 0xad, 0x94, 0x04, 0xbc, 0x12, 0x38, 0x07,
+    0xef, 0xbb, 0x76, 0x63, 0x80, 0xd5, 0xc4, 0xd2, 0x68, 0xc4, 0x44, 0xa6, 0x78, 0x65, 0x8a, 0xab,
+    0x5d, 0xcd, 0x07, 0xd4, 0x9f, 0xb1, 0xe6, 0x83, 0xab, 0x96, 0xd6, 0xcf, 0x04, 0x2f, 0x53, 0x4c,
+    0x8c, 0xbc, 0x4c, 0x33, 0x36, 0xf7, 0x49, 0x9d, 0x2a, 0xb6, 0xf4, 0xa3, 0x17, 0x30, 0x15, 0x30,
+    0x13, 0x06, 0x0b, 0x2b, 0x06, 0x01, 0x04, 0x01, 0x82, 0xe5, 0x1c, 0x02, 0x01, 0x01, 0x04, 0x04,
+    0x03, 0x02, 0x05, 0x20, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02,
+    0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x21, 0x00, 0xcc, 0x8b, 0x15, 0x81, 0xcd, 0xf0, 0xaf, 0xaf,
+    0x70, 0xcf, 0x39, 0x7b, 0x40, 0x12, 0xbf, 0x2a, 0x3a, 0xeb, 0x9a, 0x43, 0x70, 0xa6, 0x2c, 0x5b,
+    0xea, 0xe0, 0x0b, 0xa7, 0x2e, 0xb1, 0x56, 0x32, 0x02, 0x20, 0x4d, 0xfc, 0x0b, 0x6a, 0x09, 0xcb,
+    0x91, 0x4b, 0x99, 0x52, 0xe1, 0x72, 0xf2, 0x89, 0x8a, 0xb8, 0x78, 0x84, 0x8b, 0x59, 0xb4, 0x52,
+    0x8c, 0xf7, 0xbb, 0xed, 0x19, 0x7f, 0xb9, 0xbd, 0xdd, 0x0a};
 
 /******************************************/
 /*      Target attestation definition     */
@@ -346,3 +319,21 @@ static const uint8_t TEST_U2F_STAX_ATTESTATION_CERT[] = {
 #define ATTESTATION_CERT TEST_U2F_STAX_ATTESTATION_CERT
 #endif
 #endif
+
+/******************************************/
+/*   Known apps directory signature key   */
+/******************************************/
+
+#ifdef HAVE_KNOWN_APPS_NVM
+#if defined(PROD_KNOWN_APPS_PUBLIC_KEY)
+static const uint8_t KNOWN_APPS_PUBLIC_KEY[] = {PROD_KNOWN_APPS_PUBLIC_KEY};
+#else
+// Test key, its private part is in tests/speculos/ctap1_client.py
+static const uint8_t KNOWN_APPS_PUBLIC_KEY[] = {
+    0x04, 0xad, 0xaf, 0x87, 0x5f, 0x39, 0x1d, 0x6a, 0xff, 0xc4, 0x49, 0x52, 0x01, 0xbc, 0x40, 0x92,
+    0xf1, 0x29, 0xe1, 0x6a, 0x9b, 0xe1, 0x53, 0x0e, 0xa0, 0xb3, 0xf5, 0xde, 0x9f, 0x59, 0x9f, 0x01,
+    0x52, 0xf2, 0xea, 0x4e, 0x8c, 0x68, 0xf4, 0xc6, 0x1e, 0x1a, 0x12, 0x1d, 0xbe, 0x6e, 0x2a, 0xd0,
+    0xa9, 0xff, 0x2f, 0xf0, 0x13, 0x8c, 0xb4, 0x22, 0xb2, 0x37, 0x90, 0xd0, 0x01, 0xf0, 0xf6, 0x6e,
+    0x36};
+#endif
+#endif
@@ -0,0 +1,130 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __CTAP2_H__
+#define __CTAP2_H__
+
+#include "cx.h"
+
+#include "cbor.h"
+
+/* CTAP2 authenticatorMakeCredential, authenticatorGetAssertion and
+ * authenticatorGetInfo, for ES256 credentials which are not stored on the
+ * device: credential ids are the same key handles as U2F ones.
+ * Requests and responses are a command or status byte followed by CBOR data.
+ */
+
+#define CTAP2_CMD_MAKE_CREDENTIAL 0x01
+#define CTAP2_CMD_GET_ASSERTION   0x02
+#define CTAP2_CMD_GET_INFO        0x04
+
+#define CTAP2_OK                        0x00
+#define CTAP1_ERR_INVALID_COMMAND       0x01
+#define CTAP1_ERR_INVALID_PARAMETER     0x02
+#define CTAP1_ERR_INVALID_LENGTH        0x03
+#define CTAP2_ERR_CBOR_UNEXPECTED_TYPE  0x11
+#define CTAP2_ERR_INVALID_CBOR          0x12
+#define CTAP2_ERR_MISSING_PARAMETER     0x14
+#define CTAP2_ERR_LIMIT_EXCEEDED        0x15
+#define CTAP2_ERR_CREDENTIAL_EXCLUDED   0x19
+#define CTAP2_ERR_UNSUPPORTED_ALGORITHM 0x26
+#define CTAP2_ERR_OPERATION_DENIED      0x27
+#define CTAP2_ERR_UNSUPPORTED_OPTION    0x2B
+#define CTAP2_ERR_INVALID_OPTION        0x2C
+#define CTAP2_ERR_NO_CREDENTIALS        0x2E
+#define CTAP2_ERR_PIN_AUTH_INVALID      0x33
+#define CTAP1_ERR_OTHER                 0x7F
+
+// Largest request, command byte included, which fits in an APDU with its
+// extended length header and Le
+#define CTAP2_MAX_MESSAGE_SIZE (IO_APDU_BUFFER_SIZE - 7 - 2)
+
+#define CTAP2_CLIENT_DATA_HASH_SIZE 32
+
+// Bound the number of credential_unwrap() calls done for an allowList or excludeList
+#define CTAP2_CREDENTIAL_LIST_MAX_COUNT 64
+
+// Flags of the authenticator data
+#define CTAP2_FLAG_USER_PRESENT             0x01
+#define CTAP2_FLAG_ATTESTED_CREDENTIAL_DATA 0x40
+
+typedef struct ctap2_request_s {
+    const uint8_t *client_data_hash;
+    const char *rp_id;
+    uint32_t rp_id_length;
+    // Descriptors of the allowList of getAssertion or of the excludeList of
+    // makeCredential, already checked by the parser
+    cbor_reader_t credentials;
+    uint32_t credentials_count;
+    // "up" option, false for a getAssertion without user presence check
+    bool user_presence;
+} ctap2_request_t;
+
+/**
+ * Parse a makeCredential or getAssertion request, data starting after the command byte.
+ * Unsupported algorithms and options are rejected here.
+ * Return CTAP2_OK or the status code of the error.
+ */
+uint8_t ctap2_parse_make_credential(const uint8_t *data, uint32_t length, ctap2_request_t *request);
+uint8_t ctap2_parse_get_assertion(const uint8_t *data, uint32_t length, ctap2_request_t *request);
+
+/**
+ * Read the next descriptor of request->credentials, credentials_count times.
+ * id is NULL for a descriptor whose type is not "public-key", to be ignored.
+ */
+void ctap2_next_credential(ctap2_request_t *request, const uint8_t **id, uint32_t *id_length);
+
+/**
+ * Compute SHA-256(rpId), the rpIdHash matching the U2F application parameter.
+ */
+cx_err_t ctap2_compute_rp_id_hash(const ctap2_request_t *request, uint8_t *rp_id_hash);
+
+/**
+ * Write the getInfo response.
+ */
+void ctap2_write_get_info(cbor_writer_t *writer);
+
+/**
+ * Write the makeCredential response, with a "fido-u2f" attestation statement
+ * whose signature is the one of the U2F registration response.
+ * public_key is the uncompressed point of the credential public key.
+ */
+void ctap2_write_make_credential(cbor_writer_t *writer,
+                                 const uint8_t *rp_id_hash,
+                                 const uint8_t *credential_id,
+                                 uint8_t credential_id_length,
+                                 const uint8_t *public_key,
+                                 const uint8_t *signature,
+                                 uint8_t signature_length,
+                                 const uint8_t *certificate,
+                                 uint32_t certificate_length);
+
+/**
+ * Write the getAssertion response, whose authenticator data is
+ * rp_id_hash | flags | counter.
+ */
+void ctap2_write_get_assertion(cbor_writer_t *writer,
+                               const uint8_t *rp_id_hash,
+                               uint8_t flags,
+                               const uint8_t *counter,
+                               const uint8_t *credential_id,
+                               uint8_t credential_id_length,
+                               const uint8_t *signature,
+                               uint8_t signature_length);
+
+#endif
@@ -19,6 +19,81 @@
 #ifndef __FIDO_KNOWN_APPS_H__
 #define __FIDO_KNOWN_APPS_H__
 
+#ifdef HAVE_KNOWN_APPS_NVM
+
+#ifndef FIDO_KNOWN_APPS_NVM_MAX_COUNT
+#define FIDO_KNOWN_APPS_NVM_MAX_COUNT 256
+#endif
+
+#ifndef FIDO_KNOWN_APPS_NVM_NAMES_SIZE
+#define FIDO_KNOWN_APPS_NVM_NAMES_SIZE 2048
+#endif
+
+/* Header of the known apps directory:
+ *
+ * +-------------------+------------------------+------------------------+
+ * | Version (BE)      | Records count (BE)     | Names area size (BE)   |
+ * +-------------------+------------------------+------------------------+
+ * | 4 B               | 2 B                    | 2 B                    |
+ * +-------------------+------------------------+------------------------+
+ *
+ * The signed directory is the header, then the records, then the names area.
+ * Each directory must have a greater version than the loaded one, so that an
+ * older signed directory can't be loaded again.
+ */
+#define FIDO_KNOWN_APPS_HEADER_SIZE 8
+
+/* Record of the known apps directory loaded in NVM:
+ *
+ * +-------------------+------------------------+
+ * | rpIdHash prefix   | Name offset (BE)       |
+ * +-------------------+------------------------+
+ * | 8 B               | 2 B                    |
+ * +-------------------+------------------------+
+ *
+ * Records are sorted by prefix, and the name offset points to the start of a
+ * NUL-terminated printable ASCII string of the names area.
+ */
+#define FIDO_KNOWN_APPS_PREFIX_SIZE 8
+#define FIDO_KNOWN_APPS_RECORD_SIZE (FIDO_KNOWN_APPS_PREFIX_SIZE + 2)
+
+#endif
+
+/**
+ * Return the name of the app whose rpIdHash is applicationParameter, looking
+ * in the built-in table first, then in the directory loaded in NVM.
+ * Return NULL if the app is unknown.
+ */
 const char *fido_match_known_appid(const uint8_t *applicationParameter);
 
+#ifdef HAVE_KNOWN_APPS_NVM
+/**
+ * Loading of the NVM directory signed by the vendor:
+ * - fido_known_apps_load_begin() takes the directory header,
+ * - fido_known_apps_load_records() and fido_known_apps_load_names() write
+ *   chunks of the records and names areas, in order, and hash them,
+ * - fido_known_apps_load_commit() takes the DER encoded ECDSA secp256r1
+ *   signature of the SHA-256 of the directory, checks it and the directory,
+ *   and only then enables it.
+ * The current directory is disabled by the first chunk changing it. A directory
+ * without records and names clears the NVM directory.
+ *
+ * Functions return 0 on success, < 0 on error, which aborts the load.
+ */
+int fido_known_apps_load_begin(const uint8_t *header, uint32_t length);
+int fido_known_apps_load_records(uint16_t index, const uint8_t *data, uint32_t length);
+int fido_known_apps_load_names(uint16_t offset, const uint8_t *data, uint32_t length);
+int fido_known_apps_load_commit(const uint8_t *signature, uint32_t length);
+
+/**
+ * Return the number of records of the enabled NVM directory.
+ */
+uint16_t fido_known_apps_nvm_count(void);
+
+/**
+ * Return the version of the last directory committed, 0 if none.
+ */
+uint32_t fido_known_apps_nvm_version(void);
+#endif
+
 #endif
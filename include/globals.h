@@ -22,18 +22,24 @@
 #include "u2f_service.h"
 
 #include "credential.h"
+#include "scratch.h"
 #include "u2f_process.h"
 
 extern char verifyHash[65];
-extern char verifyName[20];
+extern char verifyName[65];
 
 extern u2f_service_t G_io_u2f;
 
+// Incremented on each ticker event, about every 100 ms
+extern uint32_t tickCount;
+
 typedef struct shared_ctx_s {
     union shared_ctx_u {
         u2f_data_t u2fData;
     } u;
-    uint8_t sharedBuffer[500];
+    u2f_stream_t stream;
+    credential_cache_t credentialCache;
+    scratch_t scratch;
 } shared_ctx_t;
 
 extern shared_ctx_t shared_ctx;
@@ -42,4 +48,16 @@ static inline u2f_data_t *globals_get_u2f_data(void) {
     return &shared_ctx.u.u2fData;
 }
 
+static inline u2f_stream_t *globals_get_u2f_stream(void) {
+    return &shared_ctx.stream;
+}
+
+static inline credential_cache_t *globals_get_credential_cache(void) {
+    return &shared_ctx.credentialCache;
+}
+
+static inline scratch_t *globals_get_scratch(void) {
+    return &shared_ctx.scratch;
+}
+
 #endif
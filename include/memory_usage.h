@@ -0,0 +1,71 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __MEMORY_USAGE_H__
+#define __MEMORY_USAGE_H__
+
+#include <stdint.h>
+
+/* Stack high-water marks per command class, and size of the main static buffers,
+ * readable with a proprietary APDU.
+ * The stack is painted at boot, then after each command the painted words left
+ * intact tell how deep it went, and the stack is painted again.
+ * This is compiled out unless HAVE_MEMORY_USAGE is defined, see MEMORY_USAGE
+ * in the Makefile.
+ */
+
+#define MEMORY_USAGE_CLASS_BACKGROUND 0  // IO, UI and ticker events between commands
+#define MEMORY_USAGE_CLASS_ENROLL     1
+#define MEMORY_USAGE_CLASS_SIGN       2
+#define MEMORY_USAGE_CLASS_OTHER      3
+#define MEMORY_USAGE_CLASS_COUNT      4
+
+#ifdef HAVE_MEMORY_USAGE
+
+/**
+ * Paint the stack below the caller frame, must be called once at boot.
+ */
+void memory_usage_paint_stack(void);
+
+/**
+ * Account the stack used since the previous checkpoint to usage_class, and paint it again.
+ */
+void memory_usage_checkpoint(uint8_t usage_class);
+
+/**
+ * Forget the high-water marks measured so far.
+ */
+void memory_usage_reset(void);
+
+/**
+ * Serialize the memory usage in buffer.
+ * Return the length written, or -1 if buffer is too small.
+ */
+int memory_usage_serialize(uint8_t *buffer, uint32_t size);
+
+#else
+
+static inline void memory_usage_paint_stack(void) {
+}
+static inline void memory_usage_checkpoint(uint8_t usage_class) {
+    (void) usage_class;
+}
+
+#endif
+
+#endif
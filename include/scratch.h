@@ -0,0 +1,58 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __SCRATCH_H__
+#define __SCRATCH_H__
+
+#include "cx.h"
+
+/* Scratch contexts carved from shared_ctx rather than the stack, to keep the
+ * peak stack usage low.
+ * Each slot has a single owner at a time: it is acquired at the start of a
+ * phase, and released at its end, which zeroes it. Owners of different slots
+ * may be nested, owners of the same slot must not.
+ */
+typedef struct scratch_s {
+    // Digests of the enroll and sign responses, and of the credential cache
+    cx_sha256_t hash;
+    // Credential HMAC and private key derivation
+    cx_sha256_t hmac;
+    // Public key generation on enroll
+    cx_ecfp_public_key_t publicKey;
+    // Enroll key pair, v1 credential check and attestation signature
+    cx_ecfp_private_key_t privateKey;
+} scratch_t;
+
+cx_sha256_t *scratch_acquire_hash(void);
+void scratch_release_hash(void);
+
+cx_sha256_t *scratch_acquire_hmac(void);
+void scratch_release_hmac(void);
+
+cx_ecfp_public_key_t *scratch_acquire_public_key(void);
+void scratch_release_public_key(void);
+
+cx_ecfp_private_key_t *scratch_acquire_private_key(void);
+void scratch_release_private_key(void);
+
+/**
+ * Zero all slots, when their owners may have been interrupted by an exception.
+ */
+void scratch_reset(void);
+
+#endif
@@ -0,0 +1,92 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdint.h>
+
+/* Request statistics, kept in RAM only and readable with a proprietary APDU.
+ * They are compiled out unless HAVE_STATS is defined, see STATS in the Makefile.
+ */
+
+// Latency histograms, in ticker periods (about 100 ms)
+#define STATS_HISTOGRAM_PARSE_TO_PROMPT     0
+#define STATS_HISTOGRAM_CONFIRM_TO_RESPONSE 1
+#define STATS_HISTOGRAM_REQUEST             2
+#define STATS_HISTOGRAM_COUNT               3
+// Bucket 0 counts 0 tick, bucket i counts [2^(i-1), 2^i - 1] ticks, the last one is open
+#define STATS_HISTOGRAM_BUCKETS 8
+
+#ifdef HAVE_STATS
+
+/**
+ * A request with the given INS was received.
+ */
+void stats_request_start(uint8_t ins);
+
+/**
+ * The request being processed now waits for user presence.
+ */
+void stats_request_prompted(void);
+
+/**
+ * The user answered the request waiting for user presence, or it timed out.
+ */
+void stats_user_presence_answered(void);
+
+/**
+ * The response to the request being processed was built with the given status word.
+ */
+void stats_request_done(uint16_t status_word);
+
+/**
+ * A NVM write of length bytes was done.
+ */
+void stats_nvm_write(uint32_t length);
+
+/**
+ * Reset all statistics.
+ */
+void stats_reset(void);
+
+/**
+ * Serialize all statistics in buffer.
+ * Return the length written, or -1 if buffer is too small.
+ */
+int stats_serialize(uint8_t *buffer, uint32_t size);
+
+#else
+
+static inline void stats_request_start(uint8_t ins) {
+    (void) ins;
+}
+static inline void stats_request_prompted(void) {
+}
+static inline void stats_user_presence_answered(void) {
+}
+static inline void stats_request_done(uint16_t status_word) {
+    (void) status_word;
+}
+static inline void stats_nvm_write(uint32_t length) {
+    (void) length;
+}
+
+#endif
+
+#endif
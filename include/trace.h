@@ -0,0 +1,73 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+/* Timeline of the latest requests, kept in a RAM ring and readable with a
+ * proprietary APDU. It is compiled out unless HAVE_TRACE is defined, see TRACE
+ * in the Makefile.
+ * Records are timestamped with tickCount, the only time source available to
+ * the app, which is incremented every 100 ms by the ticker event. Most phases
+ * of a request take less than a tick, so the trace gives the order of the
+ * events and the phases spanning several ticks (user presence, slow crypto),
+ * not a per-phase latency: use the benchmarks for the latter.
+ */
+
+#define TRACE_EVENT_APDU_RECEIVED  0x01  // arg: INS
+#define TRACE_EVENT_LENGTH_PARSED  0x02  // arg: data length
+#define TRACE_EVENT_UNWRAP_DONE    0x03  // arg: nonce length, 0xFFFF if invalid
+#define TRACE_EVENT_PROMPT_SHOWN   0x04  // arg: 1 for enroll, 0 for sign
+#define TRACE_EVENT_USER_DECISION  0x05  // arg: 1 if confirmed, 0 if cancelled
+#define TRACE_EVENT_KEY_DERIVED    0x06  // arg: 0 on success
+#define TRACE_EVENT_SIGNATURE_DONE 0x07  // arg: signature length, 0xFFFF on error
+#define TRACE_EVENT_REPLY          0x08  // arg: status word
+
+// Records returned by a single dump APDU
+#define TRACE_PAGE_RECORDS 32
+
+#ifdef HAVE_TRACE
+
+/**
+ * Add a record to the ring, overwriting the oldest one when it is full.
+ */
+void trace_record(uint8_t event, uint16_t arg);
+
+/**
+ * Remove all records.
+ */
+void trace_clear(void);
+
+/**
+ * Serialize a page of the records present when page 0 was last serialized, oldest first.
+ * Return the length written, or -1 if buffer is too small.
+ */
+int trace_serialize_page(uint8_t page, uint8_t *buffer, uint32_t size);
+
+#else
+
+static inline void trace_record(uint8_t event, uint16_t arg) {
+    (void) event;
+    (void) arg;
+}
+
+#endif
+
+#endif
@@ -19,13 +19,106 @@
 #ifndef __U2F_PROCESS_H__
 #define __U2F_PROCESS_H__
 
+#include "cx.h"
+
+#define U2F_USER_KEY_SIZE              65
+#define U2F_ATTESTATION_SIGNATURE_SIZE 72
+
+// Bound the number of credential_unwrap() calls done for a single request
+#define CHECK_KEY_HANDLES_MAX_COUNT 64
+
+// Steps of an enroll response computation, run on ticker events while the user reviews it
+typedef enum {
+    U2F_ENROLL_STEP_IDLE = 0,
+    U2F_ENROLL_STEP_KEY_PAIR,
+    U2F_ENROLL_STEP_KEY_HANDLE,
+    U2F_ENROLL_STEP_SIGNATURE,
+    U2F_ENROLL_STEP_DONE,
+    U2F_ENROLL_STEP_ERROR,
+} u2f_enroll_step_t;
+
+/* State of the pending request waiting for user presence.
+ * There is at most one: while it waits, the U2F transport answers identical
+ * retries itself and raises EXCEPTION_IO_RESET on any other request, which
+ * drops the pending one. Each request must also be approved by its own user
+ * presence check.
+ */
 typedef struct u2f_data_t {
     uint8_t user_presence_request_type;
+    // Whether the request is a CTAP2 makeCredential (enroll) or getAssertion (sign)
+    bool ctap2;
+    // CTAP2 makeCredential whose excludeList holds a credential of this device,
+    // refused once the user presence is confirmed
+    bool ctap2_excluded;
+    // tickCount when the user presence request was received
+    uint32_t user_presence_request_tick;
     uint8_t challenge_param[32];
     uint8_t application_param[32];
     uint8_t nonce[CREDENTIAL_NONCE_SIZE];
+    uint8_t nonce_length;
+    // Private key of a pending sign request, derived before the user confirms
+    bool private_key_valid;
+    cx_ecfp_private_key_t private_key;
+    // Credential ID of a pending CTAP2 getAssertion request, returned in its response
+    uint8_t sign_key_handle[CREDENTIAL_MAX_SIZE];
+    uint8_t sign_key_handle_length;
+    // Parts of a pending enroll response, computed before the user confirms
+    uint8_t enroll_step;
+    uint8_t enroll_user_key[U2F_USER_KEY_SIZE];
+    uint8_t enroll_key_handle[CREDENTIAL_MAX_SIZE];
+    uint8_t enroll_key_handle_length;
+    uint8_t enroll_signature[U2F_ATTESTATION_SIGNATURE_SIZE];
+    uint8_t enroll_signature_length;
 } u2f_data_t;
 
+/* State of a check key handles request, consumed as its chunks arrive so that
+ * the key handles list can be longer than an APDU.
+ */
+typedef struct u2f_check_key_handles_stream_t {
+    uint8_t application_param[32];
+    uint8_t application_param_length;
+    // Key handle being received, once its length byte was received
+    bool key_handle_started;
+    uint8_t key_handle_length;
+    uint8_t key_handle_received;
+    uint8_t key_handle[CREDENTIAL_MAX_SIZE];
+    uint8_t count;
+    uint8_t bitmap[CHECK_KEY_HANDLES_MAX_COUNT / 8];
+} u2f_check_key_handles_stream_t;
+
+/* Request received in several APDUs with ISO 7816-4 command chaining: the CLA
+ * chaining bit is set on all of them but the last one, which gets the response.
+ * Only commands streaming their data support it.
+ */
+typedef struct u2f_stream_t {
+    // Whether a chained request is being received, and its command
+    bool active;
+    uint8_t ins;
+    uint8_t p1;
+    uint8_t p2;
+    union u2f_stream_u {
+        u2f_check_key_handles_stream_t checkKeyHandles;
+    } u;
+} u2f_stream_t;
+
 void handleApdu(unsigned char *flags, unsigned short *tx, unsigned short length);
 
+/**
+ * Wipe the pending request, if any, including its private key and partial enroll response.
+ * Must be called on every path dropping the pending request.
+ */
+void u2f_wipe_pending_request(void);
+
+/**
+ * Drop the chained request being received, if any.
+ */
+void u2f_reset_stream(void);
+
+/**
+ * Cancel a pending request waiting for too long, advance the computation of a
+ * pending enroll response, or refill the presignature pool when the app is idle.
+ * Called on each ticker event, about every 100 ms.
+ */
+void u2f_ticker_event(void);
+
 #endif
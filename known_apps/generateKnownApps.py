@@ -0,0 +1,115 @@
+#!/bin/python3
+import argparse
+import hashlib
+import json
+import os
+import sys
+
+DEFAULT_INPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "known_apps.json")
+
+HEADER = """/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+// Generated by known_apps/generateKnownApps.py from known_apps/known_apps.json
+// Do not edit manually.
+
+#ifndef __FIDO_KNOWN_APPS_DB_H__
+#define __FIDO_KNOWN_APPS_DB_H__
+"""
+
+FOOTER = """
+#endif
+"""
+
+
+def load_known_apps(path):
+    with open(path, "r") as f:
+        apps = json.load(f)
+
+    entries = {}
+    for app in apps:
+        rp_id_hash = hashlib.sha256(app["id"].encode("utf8")).digest()
+        if rp_id_hash in entries:
+            raise ValueError("Duplicate id {}".format(app["id"]))
+        entries[rp_id_hash] = (app["id"], app["name"])
+    return entries
+
+
+def generate(entries):
+    # Deduplicated names, concatenated and referenced by their offset
+    names = []
+    names_offset = {}
+    offset = 0
+    for _, name in entries.values():
+        if name not in names_offset:
+            names_offset[name] = offset
+            names.append(name)
+            offset += len(name.encode("utf8")) + 1
+    if offset > 0xffff:
+        raise ValueError("Names do not fit in a 16 bits offset")
+
+    lines = [HEADER]
+    lines.append("#define FIDO_KNOWN_APPS_COUNT {}".format(len(entries)))
+    lines.append("")
+
+    # Sorted by hash for binary search
+    lines.append("static const fido_known_appid_t FIDO_KNOWN_APPS[FIDO_KNOWN_APPS_COUNT] = {")
+    for rp_id_hash in sorted(entries.keys()):
+        app_id, name = entries[rp_id_hash]
+        hash_bytes = ["0x{:02x}".format(x) for x in rp_id_hash]
+        lines.append("    {{// {}".format(app_id))
+        lines.append("     {" + ", ".join(hash_bytes[:11]) + ",")
+        lines.append("      " + ", ".join(hash_bytes[11:22]) + ",")
+        lines.append("      " + ", ".join(hash_bytes[22:]) + "},")
+        lines.append("     {}}},".format(names_offset[name]))
+    lines.append("};")
+    lines.append("")
+
+    lines.append("static const char FIDO_KNOWN_APPS_NAMES[] =")
+    for name in names:
+        lines.append("    \"{}\\0\"".format(name))
+    lines[-1] += ";"
+
+    lines.append(FOOTER)
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the known apps table")
+    parser.add_argument("--input", default=DEFAULT_INPUT, help="known apps JSON file")
+    parser.add_argument("--output", help="header to generate, default to stdout")
+    parser.add_argument("--check", action="store_true",
+                        help="check that the output is up to date instead of writing it")
+    args = parser.parse_args()
+
+    content = generate(load_known_apps(args.input))
+
+    if args.check:
+        with open(args.output, "r") as f:
+            if f.read() != content:
+                print("error: {} is not up to date, run {}".format(args.output, sys.argv[0]))
+                exit(1)
+    elif args.output:
+        with open(args.output, "w") as f:
+            f.write(content)
+    else:
+        print(content, end="")
+
+
+if __name__ == "__main__":
+    main()
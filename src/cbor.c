@@ -0,0 +1,300 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#include <string.h>
+
+#include "cbor.h"
+
+// Additional information values of the initial byte
+#define CBOR_INFO_UINT8      24
+#define CBOR_INFO_UINT16     25
+#define CBOR_INFO_UINT32     26
+#define CBOR_SIMPLE_FALSE    20
+#define CBOR_SIMPLE_TRUE     21
+#define CBOR_INITIAL(type, info) (((type) << 5) | (info))
+
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *buffer, uint32_t length) {
+    reader->buffer = buffer;
+    reader->length = length;
+    reader->offset = 0;
+}
+
+/**
+ * Read the initial byte of an item and its argument: the value of an integer,
+ * the length of a string, the number of items of an array or map.
+ * 64 bits arguments and indefinite lengths are not supported.
+ */
+static int cbor_read_header(cbor_reader_t *reader, uint8_t *type, uint32_t *value) {
+    uint8_t info;
+    uint8_t size;
+
+    if (reader->offset >= reader->length) {
+        return CBOR_ERROR_INVALID;
+    }
+    *type = reader->buffer[reader->offset] >> 5;
+    info = reader->buffer[reader->offset] & 0x1F;
+    reader->offset += 1;
+
+    if (info < CBOR_INFO_UINT8) {
+        *value = info;
+        return 0;
+    }
+
+    switch (info) {
+        case CBOR_INFO_UINT8:
+            size = 1;
+            break;
+        case CBOR_INFO_UINT16:
+            size = 2;
+            break;
+        case CBOR_INFO_UINT32:
+            size = 4;
+            break;
+        default:
+            return CBOR_ERROR_INVALID;
+    }
+    if (reader->length - reader->offset < size) {
+        return CBOR_ERROR_INVALID;
+    }
+
+    *value = 0;
+    while (size-- > 0) {
+        *value = (*value << 8) | reader->buffer[reader->offset++];
+    }
+    return 0;
+}
+
+static int cbor_read_typed_header(cbor_reader_t *reader, uint8_t expected, uint32_t *value) {
+    uint32_t offset = reader->offset;
+    uint8_t type;
+
+    if (cbor_read_header(reader, &type, value) < 0) {
+        return CBOR_ERROR_INVALID;
+    }
+    if (type != expected) {
+        // Leave the item to be read with the right type or skipped
+        reader->offset = offset;
+        return CBOR_ERROR_TYPE;
+    }
+    return 0;
+}
+
+static int cbor_read_string(cbor_reader_t *reader,
+                            uint8_t expected,
+                            const uint8_t **data,
+                            uint32_t *length) {
+    int result = cbor_read_typed_header(reader, expected, length);
+    if (result < 0) {
+        return result;
+    }
+    if (reader->length - reader->offset < *length) {
+        return CBOR_ERROR_INVALID;
+    }
+    *data = reader->buffer + reader->offset;
+    reader->offset += *length;
+    return 0;
+}
+
+int cbor_peek_type(const cbor_reader_t *reader) {
+    if (reader->offset >= reader->length) {
+        return CBOR_ERROR_INVALID;
+    }
+    return reader->buffer[reader->offset] >> 5;
+}
+
+int cbor_read_int(cbor_reader_t *reader, int32_t *value) {
+    uint32_t offset = reader->offset;
+    uint32_t argument;
+    uint8_t type;
+
+    if (cbor_read_header(reader, &type, &argument) < 0) {
+        return CBOR_ERROR_INVALID;
+    }
+    if ((type != CBOR_TYPE_UINT) && (type != CBOR_TYPE_NINT)) {
+        reader->offset = offset;
+        return CBOR_ERROR_TYPE;
+    }
+    // Larger values are valid CBOR, but never expected
+    if (argument > INT32_MAX) {
+        return CBOR_ERROR_INVALID;
+    }
+
+    if (type == CBOR_TYPE_UINT) {
+        *value = argument;
+    } else {
+        *value = -1 - (int32_t) argument;
+    }
+    return 0;
+}
+
+int cbor_read_bytes(cbor_reader_t *reader, const uint8_t **data, uint32_t *length) {
+    return cbor_read_string(reader, CBOR_TYPE_BYTES, data, length);
+}
+
+int cbor_read_text(cbor_reader_t *reader, const char **text, uint32_t *length) {
+    return cbor_read_string(reader, CBOR_TYPE_TEXT, (const uint8_t **) text, length);
+}
+
+int cbor_read_array(cbor_reader_t *reader, uint32_t *count) {
+    return cbor_read_typed_header(reader, CBOR_TYPE_ARRAY, count);
+}
+
+int cbor_read_map(cbor_reader_t *reader, uint32_t *count) {
+    return cbor_read_typed_header(reader, CBOR_TYPE_MAP, count);
+}
+
+int cbor_read_bool(cbor_reader_t *reader, bool *value) {
+    uint32_t offset = reader->offset;
+    uint32_t argument;
+    int result = cbor_read_typed_header(reader, CBOR_TYPE_SIMPLE, &argument);
+
+    if (result < 0) {
+        return result;
+    }
+    if ((argument != CBOR_SIMPLE_FALSE) && (argument != CBOR_SIMPLE_TRUE)) {
+        reader->offset = offset;
+        return CBOR_ERROR_TYPE;
+    }
+    *value = (argument == CBOR_SIMPLE_TRUE);
+    return 0;
+}
+
+static int cbor_skip_nested(cbor_reader_t *reader, uint8_t depth) {
+    uint32_t argument;
+    uint8_t type;
+
+    if (cbor_read_header(reader, &type, &argument) < 0) {
+        return CBOR_ERROR_INVALID;
+    }
+
+    switch (type) {
+        case CBOR_TYPE_UINT:
+        case CBOR_TYPE_NINT:
+        case CBOR_TYPE_SIMPLE:
+            return 0;
+        case CBOR_TYPE_BYTES:
+        case CBOR_TYPE_TEXT:
+            if (reader->length - reader->offset < argument) {
+                return CBOR_ERROR_INVALID;
+            }
+            reader->offset += argument;
+            return 0;
+        case CBOR_TYPE_ARRAY:
+        case CBOR_TYPE_MAP:
+            if (depth == CBOR_MAX_DEPTH) {
+                return CBOR_ERROR_INVALID;
+            }
+            for (uint32_t i = 0; i < argument; i++) {
+                if (cbor_skip_nested(reader, depth + 1) < 0) {
+                    return CBOR_ERROR_INVALID;
+                }
+                if ((type == CBOR_TYPE_MAP) && (cbor_skip_nested(reader, depth + 1) < 0)) {
+                    return CBOR_ERROR_INVALID;
+                }
+            }
+            return 0;
+        default:
+            // Tags are not used by CTAP2
+            return CBOR_ERROR_INVALID;
+    }
+}
+
+int cbor_skip(cbor_reader_t *reader) {
+    return cbor_skip_nested(reader, 0);
+}
+
+bool cbor_text_equals(const char *text, uint32_t length, const char *expected) {
+    return (strlen(expected) == length) && (memcmp(text, expected, length) == 0);
+}
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buffer, uint32_t size) {
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->offset = 0;
+    writer->overflow = false;
+}
+
+void cbor_write_raw(cbor_writer_t *writer, const uint8_t *data, uint32_t length) {
+    if (writer->overflow || (writer->size - writer->offset < length)) {
+        writer->overflow = true;
+        return;
+    }
+    memmove(writer->buffer + writer->offset, data, length);
+    writer->offset += length;
+}
+
+static void cbor_write_header(cbor_writer_t *writer, uint8_t type, uint32_t value) {
+    uint8_t header[5];
+    uint8_t size;
+
+    if (value < CBOR_INFO_UINT8) {
+        header[0] = CBOR_INITIAL(type, value);
+        size = 1;
+    } else if (value <= UINT8_MAX) {
+        header[0] = CBOR_INITIAL(type, CBOR_INFO_UINT8);
+        size = 2;
+    } else if (value <= UINT16_MAX) {
+        header[0] = CBOR_INITIAL(type, CBOR_INFO_UINT16);
+        size = 3;
+    } else {
+        header[0] = CBOR_INITIAL(type, CBOR_INFO_UINT32);
+        size = 5;
+    }
+    for (uint8_t i = 1; i < size; i++) {
+        header[i] = value >> (8 * (size - 1 - i));
+    }
+    cbor_write_raw(writer, header, size);
+}
+
+void cbor_write_int(cbor_writer_t *writer, int32_t value) {
+    if (value >= 0) {
+        cbor_write_header(writer, CBOR_TYPE_UINT, value);
+    } else {
+        cbor_write_header(writer, CBOR_TYPE_NINT, -1 - value);
+    }
+}
+
+void cbor_write_bytes_header(cbor_writer_t *writer, uint32_t length) {
+    cbor_write_header(writer, CBOR_TYPE_BYTES, length);
+}
+
+void cbor_write_bytes(cbor_writer_t *writer, const uint8_t *data, uint32_t length) {
+    cbor_write_bytes_header(writer, length);
+    cbor_write_raw(writer, data, length);
+}
+
+void cbor_write_text(cbor_writer_t *writer, const char *text) {
+    uint32_t length = strlen(text);
+
+    cbor_write_header(writer, CBOR_TYPE_TEXT, length);
+    cbor_write_raw(writer, (const uint8_t *) text, length);
+}
+
+void cbor_write_array(cbor_writer_t *writer, uint32_t count) {
+    cbor_write_header(writer, CBOR_TYPE_ARRAY, count);
+}
+
+void cbor_write_map(cbor_writer_t *writer, uint32_t count) {
+    cbor_write_header(writer, CBOR_TYPE_MAP, count);
+}
+
+void cbor_write_bool(cbor_writer_t *writer, bool value) {
+    uint8_t simple = CBOR_INITIAL(CBOR_TYPE_SIMPLE, value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+
+    cbor_write_raw(writer, &simple, 1);
+}
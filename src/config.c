@@ -20,55 +20,125 @@
 #include "cx.h"
 
 #include "config.h"
+#include "crypto.h"
 #include "globals.h"
+#include "stats.h"
 
 config_t const N_u2f_real;
 
-static void derive_and_store_keys(void) {
-    uint8_t key[64];
+// Next counter value to be returned, and highest value reserved in NVM.
+// Both are only meaningful once counterReserved is set.
+static uint32_t counterNext;
+static uint32_t counterReservedMark;
+static bool counterReserved;
+static uint32_t counterSavedWrites;
+
+// Fingerprint of the current seed, and whether privateHmacKey in NVM is
+// out of date with it
+static uint8_t seedFingerprint[CONFIG_SEED_FINGERPRINT_SIZE];
+static bool seedChecked;
+static bool keysStale;
+
+static cx_err_t derive_keys(uint8_t *privateHmacKey) {
     uint32_t keyPath[1];
 
     keyPath[0] = PRIVATE_KEY_PATH;
 
     // privateHmacKey
-    os_perso_derive_node_bip32(CX_CURVE_SECP256R1, keyPath, 1, key, key + 32);
-    if (memcmp(key, (uint8_t *) N_u2f.privateHmacKey, sizeof(N_u2f.privateHmacKey)) == 0) {
-        // Keys are already initialized with the proper seed and resetGeneration
-        return;
-    }
-    nvm_write((void *) N_u2f.privateHmacKey, (void *) key, sizeof(N_u2f.privateHmacKey));
+    return os_derive_bip32_no_throw(CX_CURVE_SECP256R1,
+                                    keyPath,
+                                    1,
+                                    privateHmacKey,
+                                    privateHmacKey + 32);
 }
 
 void config_init(void) {
-    uint32_t tmp32;
-    uint8_t tmp8;
+    uint8_t cookie[CX_SHA512_SIZE];
+
+    // The seed can't change while the app is running, so it is only checked
+    // on first start and not after an IO reset
+    if (!seedChecked) {
+        os_perso_seed_cookie(cookie, sizeof(cookie));
+        memcpy(seedFingerprint, cookie, sizeof(seedFingerprint));
+        explicit_bzero(cookie, sizeof(cookie));
+        seedChecked = true;
+
+        // Keys are derived and stored on first use, see config_ensure_keys()
+        keysStale = (N_u2f.initialized != 1) ||
+                    (memcmp(seedFingerprint,
+                            (uint8_t *) N_u2f.seedFingerprint,
+                            sizeof(seedFingerprint)) != 0);
+        crypto_reset_hmac_key();
+    }
 
-    if (N_u2f.initialized != 1) {
+    // Values reserved before a reboot or an IO reset may have been used,
+    // restart from the persisted mark
+    counterReserved = false;
+}
+
+int config_ensure_keys(void) {
+    config_t config;
+
+    if (!keysStale) {
+        return 0;
+    }
+
+    memcpy(&config, (const config_t *) &N_u2f, sizeof(config));
+    if (config.initialized != 1) {
 #ifdef HAVE_COUNTER_MARKER
-        tmp32 = 0xF1D0C001;
+        config.authentificationCounter = 0xF1D0C001;
 #else
-        tmp32 = 1;
+        config.authentificationCounter = 1;
 #endif
-        nvm_write((void *) &N_u2f.authentificationCounter, (void *) &tmp32, sizeof(uint32_t));
+        config.initialized = 1;
+    }
+    if (derive_keys(config.privateHmacKey) != CX_OK) {
+        explicit_bzero(&config, sizeof(config));
+        return -1;
+    }
+    memcpy(config.seedFingerprint, seedFingerprint, sizeof(config.seedFingerprint));
 
-        // Initialize keys derived from seed
-        derive_and_store_keys();
+    // Commit the whole record at once
+    nvm_write((void *) &N_u2f, (void *) &config, sizeof(config));
+    stats_nvm_write(sizeof(config));
+    explicit_bzero(&config, sizeof(config));
 
-        tmp8 = 1;
-        nvm_write((void *) &N_u2f.initialized, (void *) &tmp8, sizeof(uint8_t));
-    } else {
-        // Check that the seed did not change - if it did, overwrite the keys
-        derive_and_store_keys();
-    }
+    keysStale = false;
+    return 0;
+}
+
+static void config_reserve_counter_window(uint32_t mark) {
+    counterReservedMark = mark + CONFIG_COUNTER_WINDOW;
+    nvm_write((void *) &N_u2f.authentificationCounter,
+              &counterReservedMark,
+              sizeof(uint32_t));
+    stats_nvm_write(sizeof(uint32_t));
 }
 
 uint8_t config_increase_and_get_authentification_counter(uint8_t *buffer) {
-    uint32_t counter = N_u2f.authentificationCounter;
-    counter++;
-    nvm_write((void *) &N_u2f.authentificationCounter, &counter, sizeof(uint32_t));
+    uint32_t counter;
+
+    if (!counterReserved) {
+        if (config_ensure_keys() != 0) {
+            return 0;
+        }
+        counterNext = N_u2f.authentificationCounter + 1;
+        config_reserve_counter_window(N_u2f.authentificationCounter);
+        counterReserved = true;
+    } else if (counterNext > counterReservedMark) {
+        config_reserve_counter_window(counterReservedMark);
+    } else {
+        counterSavedWrites++;
+    }
+    counter = counterNext++;
+
     buffer[0] = ((counter >> 24) & 0xff);
     buffer[1] = ((counter >> 16) & 0xff);
     buffer[2] = ((counter >> 8) & 0xff);
     buffer[3] = (counter & 0xff);
     return 4;
 }
+
+uint32_t config_get_counter_saved_writes(void) {
+    return counterSavedWrites;
+}
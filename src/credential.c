@@ -23,86 +23,251 @@
 
 #include "credential.h"
 #include "crypto.h"
-#include "config.h"
-
-static void compute_signature(const uint8_t *rpIdHash,
-                              const cx_ecfp_private_key_t *private_key,
-                              uint8_t *signatureBuffer) {
-    cx_hmac_sha256_t hmacCtx;
-
-    cx_hmac_sha256_init(&hmacCtx,
-                        (const uint8_t *) N_u2f.privateHmacKey,
-                        sizeof(N_u2f.privateHmacKey));
-    cx_hmac((cx_hmac_t *) &hmacCtx, 0, rpIdHash, CX_SHA256_SIZE, NULL, 0);
-    cx_hmac((cx_hmac_t *) &hmacCtx,
-            CX_LAST,
-            private_key->d,
-            32,
-            signatureBuffer,
-            CREDENTIAL_SIGNATURE_SIZE);
+#include "globals.h"
+#include "scratch.h"
+
+static cx_err_t compute_signature_v1(const uint8_t *rpIdHash,
+                                     const cx_ecfp_private_key_t *private_key,
+                                     uint8_t *signatureBuffer) {
+    cx_sha256_t *hmacCtx = scratch_acquire_hmac();
+    cx_err_t error;
+
+    CX_CHECK(crypto_hmac_init(hmacCtx));
+    CX_CHECK(crypto_hmac_update(hmacCtx, rpIdHash, CX_SHA256_SIZE));
+    CX_CHECK(crypto_hmac_update(hmacCtx, private_key->d, 32));
+    CX_CHECK(crypto_hmac_final(hmacCtx, signatureBuffer));
+
+end:
+    scratch_release_hmac();
+    return error;
+}
+
+static cx_err_t compute_signature_versioned(const uint8_t *rpIdHash,
+                                            const uint8_t *versionAndNonce,
+                                            uint8_t nonceLen,
+                                            uint8_t *signatureBuffer) {
+    cx_sha256_t *hmacCtx = scratch_acquire_hmac();
+    cx_err_t error;
+
+    CX_CHECK(crypto_hmac_init(hmacCtx));
+    CX_CHECK(crypto_hmac_update(hmacCtx, versionAndNonce, 1 + nonceLen));
+    CX_CHECK(crypto_hmac_update(hmacCtx, rpIdHash, CX_SHA256_SIZE));
+    CX_CHECK(crypto_hmac_final(hmacCtx, signatureBuffer));
+
+end:
+    scratch_release_hmac();
+    return error;
 }
 
 int credential_wrap(const uint8_t *rpIdHash,
                     const uint8_t *nonce,
-                    const cx_ecfp_private_key_t *private_key,
+                    uint8_t nonceLen,
                     uint8_t *buffer,
                     uint32_t bufferLen) {
+    uint8_t signature[CX_SHA256_SIZE];
+    uint8_t version;
+    uint8_t signatureLen;
     int offset = 0;
 
-    // TODO make it retrocompatible
+    // The format is selected by the nonce length
+    if (nonceLen == CREDENTIAL_NONCE_SIZE) {
+        version = CREDENTIAL_VERSION_2;
+        signatureLen = CREDENTIAL_SIGNATURE_SIZE;
+    } else if (nonceLen == CREDENTIAL_COMPACT_NONCE_SIZE) {
+        version = CREDENTIAL_VERSION_COMPACT;
+        signatureLen = CREDENTIAL_COMPACT_SIGNATURE_SIZE;
+    } else {
+        PRINTF("Bad nonce size\n");
+        return -1;
+    }
 
     // Check for minimal size
-    if (bufferLen < CREDENTIAL_MINIMAL_SIZE) {
+    if (bufferLen < (uint32_t) (1 + nonceLen + signatureLen)) {
         PRINTF("Bad size\n");
         return -1;
     }
 
-    // Add nonce to the credential
+    // Add version and nonce to the credential
     if (nonce == NULL) {
         PRINTF("Missing nonce\n");
         return -1;
     }
-    memcpy(buffer + offset, nonce, CREDENTIAL_NONCE_SIZE);
-    offset += CREDENTIAL_NONCE_SIZE;
+    buffer[offset] = version;
+    offset += 1;
+    memcpy(buffer + offset, nonce, nonceLen);
+    offset += nonceLen;
 
-    compute_signature(rpIdHash, private_key, buffer + offset);
-    offset += CREDENTIAL_SIGNATURE_SIZE;
+    if (compute_signature_versioned(rpIdHash, buffer, nonceLen, signature) != CX_OK) {
+        explicit_bzero(signature, sizeof(signature));
+        return -1;
+    }
+    memcpy(buffer + offset, signature, signatureLen);
+    offset += signatureLen;
+    explicit_bzero(signature, sizeof(signature));
 
     return offset;
 }
 
+static int credential_check_v1(const uint8_t *rpIdHash, const uint8_t *credId) {
+    cx_ecfp_private_key_t *private_key = scratch_acquire_private_key();
+    uint8_t computedSignature[CREDENTIAL_SIGNATURE_SIZE];
+    bool valid;
+
+    // The v1 signature covers the private key, which must be generated first
+    if (crypto_generate_private_key(credId,
+                                    CREDENTIAL_NONCE_SIZE,
+                                    private_key,
+                                    CX_CURVE_SECP256R1) != 0) {
+        scratch_release_private_key();
+        return -1;
+    }
+
+    valid = (compute_signature_v1(rpIdHash, private_key, computedSignature) == CX_OK);
+    scratch_release_private_key();
+
+    valid = valid && crypto_compare(computedSignature,
+                                    credId + CREDENTIAL_NONCE_SIZE,
+                                    CREDENTIAL_SIGNATURE_SIZE);
+    explicit_bzero(computedSignature, sizeof(computedSignature));
+
+    return valid ? 0 : -1;
+}
+
+static int credential_check_versioned(const uint8_t *rpIdHash,
+                                      const uint8_t *credId,
+                                      uint8_t nonceLen,
+                                      uint8_t signatureLen) {
+    uint8_t computedSignature[CX_SHA256_SIZE];
+    bool valid;
+
+    valid = (compute_signature_versioned(rpIdHash, credId, nonceLen, computedSignature) == CX_OK);
+
+    valid = valid && crypto_compare(computedSignature, credId + 1 + nonceLen, signatureLen);
+    explicit_bzero(computedSignature, sizeof(computedSignature));
+
+    return valid ? 0 : -1;
+}
+
+static cx_err_t credential_cache_digest(const uint8_t *rpIdHash,
+                                        const uint8_t *credId,
+                                        uint32_t credIdLen,
+                                        uint8_t *digest) {
+    uint8_t hash[CX_SHA256_SIZE];
+    cx_sha256_t *hashCtx = scratch_acquire_hash();
+    cx_err_t error;
+
+    CX_CHECK(cx_sha256_init_no_throw(hashCtx));
+    CX_CHECK(cx_hash_no_throw(&hashCtx->header, 0, rpIdHash, CX_SHA256_SIZE, NULL, 0));
+    CX_CHECK(cx_hash_no_throw(&hashCtx->header, CX_LAST, credId, credIdLen, hash, sizeof(hash)));
+    memcpy(digest, hash, CREDENTIAL_CACHE_DIGEST_SIZE);
+
+end:
+    scratch_release_hash();
+    return error;
+}
+
+static bool credential_cache_lookup(const uint8_t *digest) {
+    credential_cache_t *cache = globals_get_credential_cache();
+    bool found = false;
+
+    // Go through all entries to not leak which one matched
+    for (uint8_t i = 0; i < CREDENTIAL_CACHE_ENTRIES; i++) {
+        credential_cache_entry_t *entry = &cache->entries[i];
+
+        if (!entry->used || (tickCount - entry->timestamp > CREDENTIAL_CACHE_LIFETIME_TICKS)) {
+            entry->used = false;
+            continue;
+        }
+        if (crypto_compare(entry->digest, digest, CREDENTIAL_CACHE_DIGEST_SIZE)) {
+            found = true;
+        }
+    }
+
+    if (found) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    return found;
+}
+
+static void credential_cache_insert(const uint8_t *digest) {
+    credential_cache_t *cache = globals_get_credential_cache();
+    credential_cache_entry_t *entry = &cache->entries[cache->next];
+
+    memcpy(entry->digest, digest, CREDENTIAL_CACHE_DIGEST_SIZE);
+    entry->timestamp = tickCount;
+    entry->used = true;
+    cache->next = (cache->next + 1) % CREDENTIAL_CACHE_ENTRIES;
+}
+
+void credential_cache_reset(void) {
+    credential_cache_t *cache = globals_get_credential_cache();
+
+    explicit_bzero(cache->entries, sizeof(cache->entries));
+    cache->next = 0;
+}
+
+void credential_cache_get_stats(uint32_t *hits, uint32_t *misses) {
+    *hits = globals_get_credential_cache()->hits;
+    *misses = globals_get_credential_cache()->misses;
+}
+
 int credential_unwrap(const uint8_t *rpIdHash,
                       uint8_t *credId,
                       uint32_t credIdLen,
                       uint8_t **noncePtr) {
-    cx_ecfp_private_key_t private_key;
-    uint8_t computedSignature[CREDENTIAL_SIGNATURE_SIZE];
+    uint8_t digest[CREDENTIAL_CACHE_DIGEST_SIZE];
+    uint8_t *nonce;
+    uint8_t nonceLen;
+    int status;
 
-    // Check for exact size
-    if (credIdLen != CREDENTIAL_MINIMAL_SIZE) {
-        PRINTF("wrong size\n");
+    // The credential version is identified by its size, then its version byte
+    if (credIdLen == CREDENTIAL_V1_SIZE) {
+        nonce = credId;
+        nonceLen = CREDENTIAL_NONCE_SIZE;
+    } else if ((credIdLen == CREDENTIAL_V2_SIZE) && (credId[0] == CREDENTIAL_VERSION_2)) {
+        nonce = credId + 1;
+        nonceLen = CREDENTIAL_NONCE_SIZE;
+    } else if ((credIdLen == CREDENTIAL_COMPACT_SIZE) &&
+               (credId[0] == CREDENTIAL_VERSION_COMPACT)) {
+        nonce = credId + 1;
+        nonceLen = CREDENTIAL_COMPACT_NONCE_SIZE;
+    } else {
+        PRINTF("wrong size or version\n");
         return -1;
     }
 
-    // Generate private key
-    crypto_generate_private_key(credId, &private_key, CX_CURVE_SECP256R1);
-
-    // Check credential signature
-    compute_signature(rpIdHash, &private_key, computedSignature);
-    explicit_bzero(&private_key, sizeof(private_key));
+    if (credIdLen == CREDENTIAL_V1_SIZE) {
+        // Checking a v1 credential derives its private key first: a credential
+        // validated a few moments ago, typically by a check-only request, does
+        // not need it to be derived again. Other versions are checked by a
+        // single HMAC, which costs about as much as the cache digest.
+        if (credential_cache_digest(rpIdHash, credId, credIdLen, digest) != CX_OK) {
+            return -1;
+        }
+        if (credential_cache_lookup(digest)) {
+            status = 0;
+        } else {
+            status = credential_check_v1(rpIdHash, credId);
+            if (status == 0) {
+                credential_cache_insert(digest);
+            }
+        }
+    } else {
+        status =
+            credential_check_versioned(rpIdHash, credId, nonceLen, credIdLen - 1 - nonceLen);
+    }
 
-    if (!crypto_compare(computedSignature,
-                        credId + CREDENTIAL_NONCE_SIZE,
-                        CREDENTIAL_SIGNATURE_SIZE)) {
+    if (status < 0) {
         PRINTF("Wrong signature\n");
-        explicit_bzero(computedSignature, sizeof(computedSignature));
         return -1;
     }
 
     // Parse nonce field
     if (noncePtr != NULL) {
-        *noncePtr = credId;
+        *noncePtr = nonce;
     }
 
-    return 0;
+    return nonceLen;
 }
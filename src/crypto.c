@@ -22,8 +22,36 @@
 #include "cx.h"
 
 #include "config.h"
+#include "crypto.h"
 #include "crypto_data.h"
 #include "credential.h"
+#include "scratch.h"
+
+#define HMAC_SHA256_BLOCK_SIZE 64
+#define HMAC_IPAD              0x36
+#define HMAC_OPAD              0x5c
+
+// SHA-256 states after absorbing the ipad and opad blocks of privateHmacKey
+static cx_sha256_t hmac_inner_midstate;
+static cx_sha256_t hmac_outer_midstate;
+static bool hmac_midstates_ready;
+
+#ifndef CRYPTO_PRESIGNATURE_POOL_SIZE
+#define CRYPTO_PRESIGNATURE_POOL_SIZE 2
+#endif
+
+#define CRYPTO_SCALAR_SIZE 32
+
+// Message independent part of an ECDSA signature: k^-1 mod n and r = (k.G).x mod n
+typedef struct crypto_presignature_t {
+    bool ready;
+    uint8_t k_inv[CRYPTO_SCALAR_SIZE];
+    uint8_t r[CRYPTO_SCALAR_SIZE];
+} crypto_presignature_t;
+
+static crypto_presignature_t presignature_pool[CRYPTO_PRESIGNATURE_POOL_SIZE];
+static uint32_t presignature_hits;
+static uint32_t presignature_misses;
 
 bool crypto_compare(const uint8_t *a, const uint8_t *b, uint16_t length) {
     uint16_t given_length = length;
@@ -43,52 +71,298 @@ bool crypto_compare(const uint8_t *a, const uint8_t *b, uint16_t length) {
     return (status == 0);
 }
 
+void crypto_reset_hmac_key(void) {
+    explicit_bzero(&hmac_inner_midstate, sizeof(hmac_inner_midstate));
+    explicit_bzero(&hmac_outer_midstate, sizeof(hmac_outer_midstate));
+    hmac_midstates_ready = false;
+}
+
+static cx_err_t crypto_init_hmac_key(void) {
+    uint8_t pad[HMAC_SHA256_BLOCK_SIZE];
+    cx_err_t error;
+
+    if (config_ensure_keys() != 0) {
+        return CX_INTERNAL_ERROR;
+    }
+
+    // privateHmacKey is exactly one block long, so it is used as is (no pre-hashing)
+    for (int i = 0; i < HMAC_SHA256_BLOCK_SIZE; i++) {
+        pad[i] = N_u2f.privateHmacKey[i] ^ HMAC_IPAD;
+    }
+    CX_CHECK(cx_sha256_init_no_throw(&hmac_inner_midstate));
+    CX_CHECK(cx_hash_no_throw(&hmac_inner_midstate.header, 0, pad, sizeof(pad), NULL, 0));
+
+    for (int i = 0; i < HMAC_SHA256_BLOCK_SIZE; i++) {
+        pad[i] = N_u2f.privateHmacKey[i] ^ HMAC_OPAD;
+    }
+    CX_CHECK(cx_sha256_init_no_throw(&hmac_outer_midstate));
+    CX_CHECK(cx_hash_no_throw(&hmac_outer_midstate.header, 0, pad, sizeof(pad), NULL, 0));
+
+    hmac_midstates_ready = true;
+
+end:
+    explicit_bzero(pad, sizeof(pad));
+    return error;
+}
+
+cx_err_t crypto_hmac_init(cx_sha256_t *hmac_ctx) {
+    cx_err_t error;
+
+    if (!hmac_midstates_ready) {
+        CX_CHECK(crypto_init_hmac_key());
+    }
+    memcpy(hmac_ctx, &hmac_inner_midstate, sizeof(cx_sha256_t));
+    return CX_OK;
+
+end:
+    crypto_reset_hmac_key();
+    return error;
+}
+
+cx_err_t crypto_hmac_update(cx_sha256_t *hmac_ctx, const uint8_t *data, size_t length) {
+    return cx_hash_no_throw(&hmac_ctx->header, 0, data, length, NULL, 0);
+}
+
+cx_err_t crypto_hmac_final(cx_sha256_t *hmac_ctx, uint8_t *mac) {
+    uint8_t inner_hash[CX_SHA256_SIZE];
+    cx_err_t error;
+
+    CX_CHECK(
+        cx_hash_no_throw(&hmac_ctx->header, CX_LAST, NULL, 0, inner_hash, sizeof(inner_hash)));
+
+    memcpy(hmac_ctx, &hmac_outer_midstate, sizeof(cx_sha256_t));
+    CX_CHECK(cx_hash_no_throw(&hmac_ctx->header,
+                              CX_LAST,
+                              inner_hash,
+                              sizeof(inner_hash),
+                              mac,
+                              CX_SHA256_SIZE));
+
+end:
+    explicit_bzero(inner_hash, sizeof(inner_hash));
+    explicit_bzero(hmac_ctx, sizeof(cx_sha256_t));
+    return error;
+}
+
 int crypto_generate_private_key(const uint8_t *nonce,
+                                uint8_t nonce_length,
                                 cx_ecfp_private_key_t *private_key,
                                 cx_curve_t curve) {
-    int status = 0;
     uint8_t private_key_data[CREDENTIAL_PRIVATE_KEY_SIZE];
+    cx_sha256_t *hmac_ctx = scratch_acquire_hmac();
+    cx_err_t error;
+
+    CX_CHECK(crypto_hmac_init(hmac_ctx));
+    CX_CHECK(crypto_hmac_update(hmac_ctx, nonce, nonce_length));
+    CX_CHECK(crypto_hmac_final(hmac_ctx, private_key_data));
+    CX_CHECK(cx_ecfp_init_private_key_no_throw(curve,
+                                               private_key_data,
+                                               CREDENTIAL_PRIVATE_KEY_SIZE,
+                                               private_key));
 
-    cx_hmac_sha256((const uint8_t *) N_u2f.privateHmacKey,
-                   sizeof(N_u2f.privateHmacKey),
-                   nonce,
-                   CREDENTIAL_NONCE_SIZE,
-                   private_key_data,
-                   CREDENTIAL_PRIVATE_KEY_SIZE);
-    if (cx_ecfp_init_private_key_no_throw(curve,
-                                          private_key_data,
-                                          CREDENTIAL_PRIVATE_KEY_SIZE,
-                                          private_key) != CX_OK) {
+end:
+    if (error != CX_OK) {
         PRINTF("Fail to init private key\n");
-        status = -1;
     }
+    scratch_release_hmac();
 
     // Reset the private key so that it doesn't stay in RAM.
     explicit_bzero(private_key_data, CREDENTIAL_PRIVATE_KEY_SIZE);
 
-    return status;
+    return (error == CX_OK) ? 0 : -1;
 }
 
 int crypto_generate_public_key(cx_ecfp_private_key_t *private_key,
                                uint8_t *public_key,
                                cx_curve_t curve) {
-    cx_ecfp_public_key_t app_public_key;
+    cx_ecfp_public_key_t *app_public_key = scratch_acquire_public_key();
+    int length = -1;
 
-    if (cx_ecfp_generate_pair_no_throw(curve, &app_public_key, private_key, 1) != CX_OK) {
+    if (cx_ecfp_generate_pair_no_throw(curve, app_public_key, private_key, 1) != CX_OK) {
         PRINTF("Fail to generate pair\n");
-        return -1;
+    } else {
+        memmove(public_key, app_public_key->W, app_public_key->W_len);
+        length = app_public_key->W_len;
     }
-    memmove(public_key, app_public_key.W, app_public_key.W_len);
 
-    return app_public_key.W_len;
+    scratch_release_public_key();
+    return length;
+}
+
+void crypto_presignature_pool_reset(void) {
+    explicit_bzero(presignature_pool, sizeof(presignature_pool));
+}
+
+static cx_err_t crypto_compute_presignature(crypto_presignature_t *presignature) {
+    cx_bn_t n, k, k_inv, x, r;
+    cx_ecpoint_t R;
+    uint8_t k_bytes[CRYPTO_SCALAR_SIZE];
+    uint8_t x_bytes[CRYPTO_SCALAR_SIZE];
+    uint8_t y_bytes[CRYPTO_SCALAR_SIZE];
+    cx_err_t error;
+    bool locked = false;
+    int diff;
+
+    // Fails if another owner holds the lock, which must then be left untouched
+    CX_CHECK(cx_bn_lock(CRYPTO_SCALAR_SIZE, 0));
+    locked = true;
+    CX_CHECK(cx_bn_alloc(&n, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&k, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&k_inv, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&x, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&r, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_ecdomain_parameter_bn(CX_CURVE_SECP256R1, CX_CURVE_PARAM_Order, n));
+
+    // Random k in [1, n - 1]
+    CX_CHECK(cx_bn_rng(k, n));
+    CX_CHECK(cx_bn_cmp_u32(k, 0, &diff));
+    if (diff == 0) {
+        error = CX_INVALID_PARAMETER;
+        goto end;
+    }
+    CX_CHECK(cx_bn_export(k, k_bytes, sizeof(k_bytes)));
+
+    // r = (k.G).x mod n, which must not be 0
+    CX_CHECK(cx_ecpoint_alloc(&R, CX_CURVE_SECP256R1));
+    CX_CHECK(cx_ecdomain_generator_bn(CX_CURVE_SECP256R1, &R));
+    CX_CHECK(cx_ecpoint_rnd_scalarmul(&R, k_bytes, sizeof(k_bytes)));
+    CX_CHECK(cx_ecpoint_export(&R, x_bytes, sizeof(x_bytes), y_bytes, sizeof(y_bytes)));
+    CX_CHECK(cx_bn_init(x, x_bytes, sizeof(x_bytes)));
+    CX_CHECK(cx_bn_reduce(r, x, n));
+    CX_CHECK(cx_bn_cmp_u32(r, 0, &diff));
+    if (diff == 0) {
+        error = CX_INVALID_PARAMETER;
+        goto end;
+    }
+
+    // n is prime
+    CX_CHECK(cx_bn_mod_invert_nprime(k_inv, k, n));
+
+    CX_CHECK(cx_bn_export(r, presignature->r, sizeof(presignature->r)));
+    CX_CHECK(cx_bn_export(k_inv, presignature->k_inv, sizeof(presignature->k_inv)));
+
+end:
+    explicit_bzero(k_bytes, sizeof(k_bytes));
+    if (locked) {
+        cx_bn_unlock();
+    }
+    return error;
+}
+
+void crypto_presignature_pool_refill(void) {
+    for (uint8_t i = 0; i < CRYPTO_PRESIGNATURE_POOL_SIZE; i++) {
+        crypto_presignature_t *presignature = &presignature_pool[i];
+
+        if (presignature->ready) {
+            continue;
+        }
+        // Only one entry per call, to keep the device responsive
+        if (crypto_compute_presignature(presignature) == CX_OK) {
+            presignature->ready = true;
+        } else {
+            explicit_bzero(presignature, sizeof(*presignature));
+        }
+        return;
+    }
+}
+
+static bool crypto_presignature_take(crypto_presignature_t *presignature) {
+    for (uint8_t i = 0; i < CRYPTO_PRESIGNATURE_POOL_SIZE; i++) {
+        if (presignature_pool[i].ready) {
+            // Each presignature is used at most once
+            memcpy(presignature, &presignature_pool[i], sizeof(crypto_presignature_t));
+            explicit_bzero(&presignature_pool[i], sizeof(crypto_presignature_t));
+            return true;
+        }
+    }
+    return false;
+}
+
+void crypto_presignature_get_stats(uint32_t *hits, uint32_t *misses) {
+    *hits = presignature_hits;
+    *misses = presignature_misses;
+}
+
+/**
+ * Finish an ECDSA signature from a presignature: s = k^-1 * (h + r * d) mod n.
+ * Return the length of the DER encoded signature, or -1 on error.
+ */
+static int crypto_sign_presigned(const uint8_t *data_hash,
+                                 const cx_ecfp_private_key_t *private_key,
+                                 const crypto_presignature_t *presignature,
+                                 uint8_t *signature) {
+    cx_bn_t n, h, e, d, r, k_inv, rd, sum, s;
+    uint8_t s_bytes[CRYPTO_SCALAR_SIZE];
+    cx_err_t error;
+    size_t length = 0;
+    bool locked = false;
+    int diff;
+
+    CX_CHECK(cx_bn_lock(CRYPTO_SCALAR_SIZE, 0));
+    locked = true;
+    CX_CHECK(cx_bn_alloc(&n, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_ecdomain_parameter_bn(CX_CURVE_SECP256R1, CX_CURVE_PARAM_Order, n));
+    CX_CHECK(cx_bn_alloc_init(&h, CRYPTO_SCALAR_SIZE, data_hash, CX_SHA256_SIZE));
+    CX_CHECK(cx_bn_alloc(&e, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_reduce(e, h, n));
+    CX_CHECK(cx_bn_alloc_init(&d, CRYPTO_SCALAR_SIZE, private_key->d, private_key->d_len));
+    CX_CHECK(cx_bn_alloc_init(&r, CRYPTO_SCALAR_SIZE, presignature->r, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc_init(&k_inv,
+                              CRYPTO_SCALAR_SIZE,
+                              presignature->k_inv,
+                              CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&rd, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&sum, CRYPTO_SCALAR_SIZE));
+    CX_CHECK(cx_bn_alloc(&s, CRYPTO_SCALAR_SIZE));
+
+    CX_CHECK(cx_bn_mod_mul(rd, r, d, n));
+    CX_CHECK(cx_bn_mod_add(sum, e, rd, n));
+    CX_CHECK(cx_bn_mod_mul(s, k_inv, sum, n));
+    CX_CHECK(cx_bn_cmp_u32(s, 0, &diff));
+    if (diff == 0) {
+        error = CX_INVALID_PARAMETER;
+        goto end;
+    }
+    CX_CHECK(cx_bn_export(s, s_bytes, sizeof(s_bytes)));
+
+    length = cx_ecfp_encode_sig_der(signature,
+                                    CRYPTO_SIGNATURE_MAX_SIZE,
+                                    presignature->r,
+                                    CRYPTO_SCALAR_SIZE,
+                                    s_bytes,
+                                    sizeof(s_bytes));
+
+end:
+    if (locked) {
+        // Wipes d and the intermediate values
+        cx_bn_unlock();
+    }
+    explicit_bzero(s_bytes, sizeof(s_bytes));
+
+    if ((error != CX_OK) || (length == 0)) {
+        return -1;
+    }
+    return length;
 }
 
 static int crypto_sign(const uint8_t *data_hash,
                        cx_ecfp_private_key_t *private_key,
                        uint8_t *signature) {
+    crypto_presignature_t presignature;
     size_t length;
     size_t domain_length;
 
+    // Use a presignature computed while the app was idle, if any
+    if (crypto_presignature_take(&presignature)) {
+        int result = crypto_sign_presigned(data_hash, private_key, &presignature, signature);
+        explicit_bzero(&presignature, sizeof(presignature));
+        if (result > 0) {
+            presignature_hits++;
+            return result;
+        }
+    }
+    presignature_misses++;
+
     if (cx_ecdomain_parameters_length(CX_CURVE_SECP256R1, &domain_length) != CX_OK) {
         return -1;
     }
@@ -116,14 +390,36 @@ int crypto_sign_application(const uint8_t *data_hash,
 }
 
 int crypto_sign_attestation(const uint8_t *data_hash, uint8_t *signature) {
-    cx_ecfp_private_key_t attestation_private_key;
+    cx_ecfp_private_key_t *attestation_private_key = scratch_acquire_private_key();
+    int result = -1;
 
     if (cx_ecfp_init_private_key_no_throw(CX_CURVE_SECP256R1,
                                           ATTESTATION_KEY,
                                           32,
-                                          &attestation_private_key) != CX_OK) {
-        return -1;
+                                          attestation_private_key) == CX_OK) {
+        result = crypto_sign(data_hash, attestation_private_key, signature);
     }
 
-    return crypto_sign(data_hash, &attestation_private_key, signature);
+    scratch_release_private_key();
+    return result;
+}
+
+#ifdef HAVE_KNOWN_APPS_NVM
+bool crypto_verify_known_apps(const uint8_t *data_hash,
+                              const uint8_t *signature,
+                              size_t signature_length) {
+    cx_ecfp_public_key_t public_key;
+
+    if (cx_ecfp_init_public_key_no_throw(CX_CURVE_SECP256R1,
+                                         KNOWN_APPS_PUBLIC_KEY,
+                                         sizeof(KNOWN_APPS_PUBLIC_KEY),
+                                         &public_key) != CX_OK) {
+        return false;
+    }
+    return cx_ecdsa_verify_no_throw(&public_key,
+                                    data_hash,
+                                    CX_SHA256_SIZE,
+                                    signature,
+                                    signature_length);
 }
+#endif
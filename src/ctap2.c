@@ -0,0 +1,595 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#include <string.h>
+
+#include "os.h"
+#include "os_io_seproxyhal.h"
+#include "cx.h"
+
+#include "ctap2.h"
+#include "scratch.h"
+
+// Parameters of the makeCredential request map
+#define MAKE_CREDENTIAL_CLIENT_DATA_HASH 0x01
+#define MAKE_CREDENTIAL_RP               0x02
+#define MAKE_CREDENTIAL_USER             0x03
+#define MAKE_CREDENTIAL_PUB_KEY_PARAMS   0x04
+#define MAKE_CREDENTIAL_EXCLUDE_LIST     0x05
+#define MAKE_CREDENTIAL_OPTIONS          0x07
+#define MAKE_CREDENTIAL_PIN_AUTH         0x08
+
+// Parameters of the getAssertion request map
+#define GET_ASSERTION_RP_ID            0x01
+#define GET_ASSERTION_CLIENT_DATA_HASH 0x02
+#define GET_ASSERTION_ALLOW_LIST       0x03
+#define GET_ASSERTION_OPTIONS          0x05
+#define GET_ASSERTION_PIN_AUTH         0x06
+
+#define CREDENTIAL_TYPE_PUBLIC_KEY "public-key"
+#define COSE_ALG_ES256             -7
+#define COSE_KTY_EC2               2
+#define COSE_CRV_P256              1
+
+// COSE_Key map of an ES256 public key, see ctap2_write_cose_key()
+#define CTAP2_COSE_KEY_SIZE 77
+
+#define CTAP2_AAGUID_SIZE 16
+#define CTAP2_COUNTER_SIZE 4
+
+// Credentials use the "fido-u2f" attestation format, whose AAGUID is all zeros
+static const uint8_t CTAP2_AAGUID[CTAP2_AAGUID_SIZE] = {0};
+
+typedef struct ctap2_options_s {
+    bool rk;
+    bool uv;
+    bool up;
+} ctap2_options_t;
+
+static uint8_t ctap2_cbor_status(int result) {
+    return (result == CBOR_ERROR_TYPE) ? CTAP2_ERR_CBOR_UNEXPECTED_TYPE : CTAP2_ERR_INVALID_CBOR;
+}
+
+/**
+ * Read a text key of a map, keeping both key and value unread on error.
+ */
+static uint8_t ctap2_read_text_key(cbor_reader_t *reader, const char **key, uint32_t *length) {
+    int result = cbor_read_text(reader, key, length);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    return CTAP2_OK;
+}
+
+static uint8_t ctap2_read_client_data_hash(cbor_reader_t *reader, ctap2_request_t *request) {
+    uint32_t length;
+    int result = cbor_read_bytes(reader, &request->client_data_hash, &length);
+
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    if (length != CTAP2_CLIENT_DATA_HASH_SIZE) {
+        return CTAP1_ERR_INVALID_LENGTH;
+    }
+    return CTAP2_OK;
+}
+
+/**
+ * Read a PublicKeyCredentialDescriptor: {"id": bytes, "type": text, ...}.
+ */
+static uint8_t ctap2_read_credential(cbor_reader_t *reader,
+                                     const uint8_t **id,
+                                     uint32_t *id_length) {
+    const char *key;
+    const char *type = NULL;
+    uint32_t key_length = 0;
+    uint32_t type_length = 0;
+    uint32_t count;
+    uint8_t status;
+    int result;
+
+    *id = NULL;
+    result = cbor_read_map(reader, &count);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        status = ctap2_read_text_key(reader, &key, &key_length);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+        if (cbor_text_equals(key, key_length, "id")) {
+            result = cbor_read_bytes(reader, id, id_length);
+        } else if (cbor_text_equals(key, key_length, "type")) {
+            result = cbor_read_text(reader, &type, &type_length);
+        } else {
+            result = cbor_skip(reader);
+        }
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+    }
+
+    if ((*id == NULL) || (type == NULL)) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+    if (!cbor_text_equals(type, type_length, CREDENTIAL_TYPE_PUBLIC_KEY)) {
+        *id = NULL;
+    }
+    return CTAP2_OK;
+}
+
+static uint8_t ctap2_read_credential_list(cbor_reader_t *reader, ctap2_request_t *request) {
+    const uint8_t *id;
+    uint32_t id_length;
+    uint8_t status;
+    int result = cbor_read_array(reader, &request->credentials_count);
+
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    if (request->credentials_count > CTAP2_CREDENTIAL_LIST_MAX_COUNT) {
+        return CTAP2_ERR_LIMIT_EXCEEDED;
+    }
+
+    // Check all the descriptors now, so that ctap2_next_credential() can't fail
+    request->credentials = *reader;
+    for (uint32_t i = 0; i < request->credentials_count; i++) {
+        status = ctap2_read_credential(reader, &id, &id_length);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+    }
+    return CTAP2_OK;
+}
+
+void ctap2_next_credential(ctap2_request_t *request, const uint8_t **id, uint32_t *id_length) {
+    ctap2_read_credential(&request->credentials, id, id_length);
+}
+
+/**
+ * Read the options map, options which are absent keep their default value.
+ */
+static uint8_t ctap2_read_options(cbor_reader_t *reader, ctap2_options_t *options) {
+    const char *key;
+    uint32_t key_length = 0;
+    uint32_t count;
+    uint8_t status;
+    int result;
+
+    result = cbor_read_map(reader, &count);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        status = ctap2_read_text_key(reader, &key, &key_length);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+        if (cbor_text_equals(key, key_length, "rk")) {
+            result = cbor_read_bool(reader, &options->rk);
+        } else if (cbor_text_equals(key, key_length, "uv")) {
+            result = cbor_read_bool(reader, &options->uv);
+        } else if (cbor_text_equals(key, key_length, "up")) {
+            result = cbor_read_bool(reader, &options->up);
+        } else {
+            result = cbor_skip(reader);
+        }
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+    }
+    return CTAP2_OK;
+}
+
+/**
+ * Read the PublicKeyCredentialRpEntity, only its id is used.
+ */
+static uint8_t ctap2_read_rp(cbor_reader_t *reader, ctap2_request_t *request) {
+    const char *key;
+    uint32_t key_length = 0;
+    uint32_t count;
+    uint8_t status;
+    int result;
+
+    result = cbor_read_map(reader, &count);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        status = ctap2_read_text_key(reader, &key, &key_length);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+        if (cbor_text_equals(key, key_length, "id")) {
+            result = cbor_read_text(reader, &request->rp_id, &request->rp_id_length);
+        } else {
+            result = cbor_skip(reader);
+        }
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+    }
+
+    if (request->rp_id == NULL) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+    return CTAP2_OK;
+}
+
+/**
+ * Read the pubKeyCredParams list, looking for ES256.
+ */
+static uint8_t ctap2_read_pub_key_cred_params(cbor_reader_t *reader, bool *es256) {
+    const char *key;
+    const char *type;
+    uint32_t key_length = 0;
+    uint32_t type_length = 0;
+    uint32_t count;
+    uint32_t params_count;
+    int32_t alg = 0;
+    bool has_alg;
+    uint8_t status;
+    int result;
+
+    result = cbor_read_array(reader, &params_count);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    for (uint32_t i = 0; i < params_count; i++) {
+        type = NULL;
+        has_alg = false;
+
+        result = cbor_read_map(reader, &count);
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+        for (uint32_t j = 0; j < count; j++) {
+            status = ctap2_read_text_key(reader, &key, &key_length);
+            if (status != CTAP2_OK) {
+                return status;
+            }
+            if (cbor_text_equals(key, key_length, "alg")) {
+                result = cbor_read_int(reader, &alg);
+                has_alg = true;
+            } else if (cbor_text_equals(key, key_length, "type")) {
+                result = cbor_read_text(reader, &type, &type_length);
+            } else {
+                result = cbor_skip(reader);
+            }
+            if (result < 0) {
+                return ctap2_cbor_status(result);
+            }
+        }
+
+        if ((type == NULL) || !has_alg) {
+            return CTAP2_ERR_MISSING_PARAMETER;
+        }
+        if (cbor_text_equals(type, type_length, CREDENTIAL_TYPE_PUBLIC_KEY) &&
+            (alg == COSE_ALG_ES256)) {
+            *es256 = true;
+        }
+    }
+    return CTAP2_OK;
+}
+
+static uint8_t ctap2_read_request_map(cbor_reader_t *reader,
+                                      const uint8_t *data,
+                                      uint32_t length,
+                                      uint32_t *count) {
+    int result;
+
+    cbor_reader_init(reader, data, length);
+    result = cbor_read_map(reader, count);
+    if (result < 0) {
+        return ctap2_cbor_status(result);
+    }
+    return CTAP2_OK;
+}
+
+uint8_t ctap2_parse_make_credential(const uint8_t *data,
+                                    uint32_t length,
+                                    ctap2_request_t *request) {
+    ctap2_options_t options = {.rk = false, .uv = false, .up = true};
+    cbor_reader_t reader;
+    uint32_t count;
+    int32_t key;
+    bool has_user = false;
+    bool has_pub_key_cred_params = false;
+    bool es256 = false;
+    bool has_pin_auth = false;
+    uint8_t status;
+    int result;
+
+    memset(request, 0, sizeof(ctap2_request_t));
+
+    status = ctap2_read_request_map(&reader, data, length, &count);
+    for (uint32_t i = 0; (status == CTAP2_OK) && (i < count); i++) {
+        result = cbor_read_int(&reader, &key);
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+
+        switch (key) {
+            case MAKE_CREDENTIAL_CLIENT_DATA_HASH:
+                status = ctap2_read_client_data_hash(&reader, request);
+                break;
+            case MAKE_CREDENTIAL_RP:
+                status = ctap2_read_rp(&reader, request);
+                break;
+            case MAKE_CREDENTIAL_USER:
+                // The user entity is not stored, as credentials are not resident
+                if (cbor_peek_type(&reader) != CBOR_TYPE_MAP) {
+                    return CTAP2_ERR_CBOR_UNEXPECTED_TYPE;
+                }
+                has_user = true;
+                status = (cbor_skip(&reader) == 0) ? CTAP2_OK : CTAP2_ERR_INVALID_CBOR;
+                break;
+            case MAKE_CREDENTIAL_PUB_KEY_PARAMS:
+                has_pub_key_cred_params = true;
+                status = ctap2_read_pub_key_cred_params(&reader, &es256);
+                break;
+            case MAKE_CREDENTIAL_EXCLUDE_LIST:
+                status = ctap2_read_credential_list(&reader, request);
+                break;
+            case MAKE_CREDENTIAL_OPTIONS:
+                status = ctap2_read_options(&reader, &options);
+                break;
+            case MAKE_CREDENTIAL_PIN_AUTH:
+                has_pin_auth = true;
+                status = (cbor_skip(&reader) == 0) ? CTAP2_OK : CTAP2_ERR_INVALID_CBOR;
+                break;
+            default:
+                // Extensions and PIN protocol are ignored
+                status = (cbor_skip(&reader) == 0) ? CTAP2_OK : CTAP2_ERR_INVALID_CBOR;
+                break;
+        }
+    }
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    if ((request->client_data_hash == NULL) || (request->rp_id == NULL) || !has_user ||
+        !has_pub_key_cred_params) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+    if (!es256) {
+        return CTAP2_ERR_UNSUPPORTED_ALGORITHM;
+    }
+    // Neither resident keys nor user verification are supported
+    if (options.rk || options.uv) {
+        return CTAP2_ERR_UNSUPPORTED_OPTION;
+    }
+    if (!options.up) {
+        return CTAP2_ERR_INVALID_OPTION;
+    }
+    if (has_pin_auth) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    request->user_presence = true;
+    return CTAP2_OK;
+}
+
+uint8_t ctap2_parse_get_assertion(const uint8_t *data, uint32_t length, ctap2_request_t *request) {
+    ctap2_options_t options = {.rk = false, .uv = false, .up = true};
+    cbor_reader_t reader;
+    uint32_t count;
+    int32_t key;
+    bool has_pin_auth = false;
+    uint8_t status;
+    int result;
+
+    memset(request, 0, sizeof(ctap2_request_t));
+
+    status = ctap2_read_request_map(&reader, data, length, &count);
+    for (uint32_t i = 0; (status == CTAP2_OK) && (i < count); i++) {
+        result = cbor_read_int(&reader, &key);
+        if (result < 0) {
+            return ctap2_cbor_status(result);
+        }
+
+        switch (key) {
+            case GET_ASSERTION_RP_ID:
+                result = cbor_read_text(&reader, &request->rp_id, &request->rp_id_length);
+                status = (result == 0) ? CTAP2_OK : ctap2_cbor_status(result);
+                break;
+            case GET_ASSERTION_CLIENT_DATA_HASH:
+                status = ctap2_read_client_data_hash(&reader, request);
+                break;
+            case GET_ASSERTION_ALLOW_LIST:
+                status = ctap2_read_credential_list(&reader, request);
+                break;
+            case GET_ASSERTION_OPTIONS:
+                status = ctap2_read_options(&reader, &options);
+                break;
+            case GET_ASSERTION_PIN_AUTH:
+                has_pin_auth = true;
+                status = (cbor_skip(&reader) == 0) ? CTAP2_OK : CTAP2_ERR_INVALID_CBOR;
+                break;
+            default:
+                // Extensions and PIN protocol are ignored
+                status = (cbor_skip(&reader) == 0) ? CTAP2_OK : CTAP2_ERR_INVALID_CBOR;
+                break;
+        }
+    }
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    if ((request->client_data_hash == NULL) || (request->rp_id == NULL)) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+    if (options.rk) {
+        return CTAP2_ERR_INVALID_OPTION;
+    }
+    if (options.uv) {
+        return CTAP2_ERR_UNSUPPORTED_OPTION;
+    }
+    if (has_pin_auth) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    request->user_presence = options.up;
+    return CTAP2_OK;
+}
+
+cx_err_t ctap2_compute_rp_id_hash(const ctap2_request_t *request, uint8_t *rp_id_hash) {
+    cx_sha256_t *hash = scratch_acquire_hash();
+    cx_err_t error;
+
+    CX_CHECK(cx_sha256_init_no_throw(hash));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              CX_LAST,
+                              (const uint8_t *) request->rp_id,
+                              request->rp_id_length,
+                              rp_id_hash,
+                              CX_SHA256_SIZE));
+
+end:
+    scratch_release_hash();
+    return error;
+}
+
+void ctap2_write_get_info(cbor_writer_t *writer) {
+    cbor_write_map(writer, 5);
+
+    // versions
+    cbor_write_int(writer, 0x01);
+    cbor_write_array(writer, 2);
+    cbor_write_text(writer, "U2F_V2");
+    cbor_write_text(writer, "FIDO_2_0");
+
+    // aaguid, zero as required by the fido-u2f attestation format
+    cbor_write_int(writer, 0x03);
+    cbor_write_bytes(writer, CTAP2_AAGUID, sizeof(CTAP2_AAGUID));
+
+    // options, in canonical order
+    cbor_write_int(writer, 0x04);
+    cbor_write_map(writer, 3);
+    cbor_write_text(writer, "rk");
+    cbor_write_bool(writer, false);
+    cbor_write_text(writer, "up");
+    cbor_write_bool(writer, true);
+    cbor_write_text(writer, "plat");
+    cbor_write_bool(writer, false);
+
+    // maxMsgSize
+    cbor_write_int(writer, 0x05);
+    cbor_write_int(writer, CTAP2_MAX_MESSAGE_SIZE);
+
+    // algorithms, only ES256
+    cbor_write_int(writer, 0x0A);
+    cbor_write_array(writer, 1);
+    cbor_write_map(writer, 2);
+    cbor_write_text(writer, "alg");
+    cbor_write_int(writer, COSE_ALG_ES256);
+    cbor_write_text(writer, "type");
+    cbor_write_text(writer, CREDENTIAL_TYPE_PUBLIC_KEY);
+}
+
+/**
+ * Write the COSE_Key of an ES256 public key given as an uncompressed point,
+ * in CTAP2_COSE_KEY_SIZE bytes.
+ */
+static void ctap2_write_cose_key(cbor_writer_t *writer, const uint8_t *public_key) {
+    cbor_write_map(writer, 5);
+    cbor_write_int(writer, 1);  // kty
+    cbor_write_int(writer, COSE_KTY_EC2);
+    cbor_write_int(writer, 3);  // alg
+    cbor_write_int(writer, COSE_ALG_ES256);
+    cbor_write_int(writer, -1);  // crv
+    cbor_write_int(writer, COSE_CRV_P256);
+    cbor_write_int(writer, -2);  // x
+    cbor_write_bytes(writer, public_key + 1, 32);
+    cbor_write_int(writer, -3);  // y
+    cbor_write_bytes(writer, public_key + 1 + 32, 32);
+}
+
+void ctap2_write_make_credential(cbor_writer_t *writer,
+                                 const uint8_t *rp_id_hash,
+                                 const uint8_t *credential_id,
+                                 uint8_t credential_id_length,
+                                 const uint8_t *public_key,
+                                 const uint8_t *signature,
+                                 uint8_t signature_length,
+                                 const uint8_t *certificate,
+                                 uint32_t certificate_length) {
+    // The counter is only used by assertions
+    const uint8_t counter[CTAP2_COUNTER_SIZE] = {0};
+    uint8_t flags = CTAP2_FLAG_USER_PRESENT | CTAP2_FLAG_ATTESTED_CREDENTIAL_DATA;
+    uint8_t credential_id_length_be[2] = {0, credential_id_length};
+
+    cbor_write_map(writer, 3);
+
+    // fmt
+    cbor_write_int(writer, 0x01);
+    cbor_write_text(writer, "fido-u2f");
+
+    // authData: rpIdHash | flags | counter | AAGUID | L | credentialId | COSE_Key
+    cbor_write_int(writer, 0x02);
+    cbor_write_bytes_header(writer,
+                            CX_SHA256_SIZE + 1 + sizeof(counter) + sizeof(CTAP2_AAGUID) + 2 +
+                                credential_id_length + CTAP2_COSE_KEY_SIZE);
+    cbor_write_raw(writer, rp_id_hash, CX_SHA256_SIZE);
+    cbor_write_raw(writer, &flags, 1);
+    cbor_write_raw(writer, counter, sizeof(counter));
+    cbor_write_raw(writer, CTAP2_AAGUID, sizeof(CTAP2_AAGUID));
+    cbor_write_raw(writer, credential_id_length_be, sizeof(credential_id_length_be));
+    cbor_write_raw(writer, credential_id, credential_id_length);
+    ctap2_write_cose_key(writer, public_key);
+
+    // attStmt
+    cbor_write_int(writer, 0x03);
+    cbor_write_map(writer, 2);
+    cbor_write_text(writer, "sig");
+    cbor_write_bytes(writer, signature, signature_length);
+    cbor_write_text(writer, "x5c");
+    cbor_write_array(writer, 1);
+    cbor_write_bytes(writer, certificate, certificate_length);
+}
+
+void ctap2_write_get_assertion(cbor_writer_t *writer,
+                               const uint8_t *rp_id_hash,
+                               uint8_t flags,
+                               const uint8_t *counter,
+                               const uint8_t *credential_id,
+                               uint8_t credential_id_length,
+                               const uint8_t *signature,
+                               uint8_t signature_length) {
+    cbor_write_map(writer, 3);
+
+    // credential
+    cbor_write_int(writer, 0x01);
+    cbor_write_map(writer, 2);
+    cbor_write_text(writer, "id");
+    cbor_write_bytes(writer, credential_id, credential_id_length);
+    cbor_write_text(writer, "type");
+    cbor_write_text(writer, CREDENTIAL_TYPE_PUBLIC_KEY);
+
+    // authData: rpIdHash | flags | counter
+    cbor_write_int(writer, 0x02);
+    cbor_write_bytes_header(writer, CX_SHA256_SIZE + 1 + CTAP2_COUNTER_SIZE);
+    cbor_write_raw(writer, rp_id_hash, CX_SHA256_SIZE);
+    cbor_write_raw(writer, &flags, 1);
+    cbor_write_raw(writer, counter, CTAP2_COUNTER_SIZE);
+
+    // signature
+    cbor_write_int(writer, 0x03);
+    cbor_write_bytes(writer, signature, signature_length);
+}
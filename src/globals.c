@@ -20,7 +20,9 @@
 
 #include "globals.h"
 
-char verifyName[20];
+char verifyName[65];
 char verifyHash[65];
 
+uint32_t tickCount;
+
 shared_ctx_t shared_ctx;
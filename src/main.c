@@ -22,7 +22,11 @@
 
 #include "globals.h"
 #include "config.h"
+#include "crypto.h"
 #include "u2f_process.h"
+#include "trace.h"
+#include "memory_usage.h"
+#include "scratch.h"
 #include "ui_shared.h"
 
 unsigned char G_io_seproxyhal_spi_buffer[IO_SEPROXYHAL_BUFFER_SIZE_B];
@@ -67,6 +71,8 @@ unsigned char io_event(unsigned char channel) {
             break;
 #endif  // HAVE_NBGL
         case SEPROXYHAL_TAG_TICKER_EVENT:
+            tickCount++;
+            u2f_ticker_event();
             UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {});
             break;
         default:
@@ -124,10 +130,36 @@ static int u2f_fill_status_code(uint16_t status_code, uint8_t *buffer) {
     return 2;
 }
 
+/**
+ * Exchange APDUs until an exception is raised, starting by sending the tx bytes
+ * response of the previous one, if any.
+ * Handlers report errors with status codes, only the SDK may still throw.
+ */
+static void apdu_loop(unsigned short tx) {
+    unsigned short rx;
+    unsigned char flags = 0;
+
+    for (;;) {
+        if (tx != 0) {
+            trace_record(TRACE_EVENT_REPLY, U2BE(G_io_apdu_buffer, tx - 2));
+        }
+        rx = io_exchange(CHANNEL_APDU | flags, tx);
+        tx = 0;
+        flags = 0;
+
+        // no apdu received, well, reset the session, and reset the
+        // bootloader configuration
+        if (rx == 0) {
+            tx = u2f_fill_status_code(0x6982, G_io_apdu_buffer);
+        } else {
+            trace_record(TRACE_EVENT_APDU_RECEIVED, G_io_apdu_buffer[1]);
+            handleApdu(&flags, &tx, rx);
+        }
+    }
+}
+
 void sample_main(void) {
-    unsigned short rx = 0;
     unsigned short tx = 0;
-    unsigned char flags = 0;
 
     // DESIGN NOTE: the bootloader ignores the way APDU are fetched. The only
     // goal is to retrieve APDU.
@@ -135,29 +167,24 @@ void sample_main(void) {
     // sure the io_event is called with a
     // switch event, before the apdu is replied to the bootloader. This avoid
     // APDU injection faults.
+    // The exception frame is only set up again after an exception, not for
+    // each APDU.
     for (;;) {
         BEGIN_TRY {
             TRY {
-                rx = io_exchange(CHANNEL_APDU | flags, tx);
-                tx = 0;
-                flags = 0;
-
-                // no apdu received, well, reset the session, and reset the
-                // bootloader configuration
-                if (rx == 0) {
-                    tx = u2f_fill_status_code(0x6982, G_io_apdu_buffer);
-                } else {
-                    handleApdu(&flags, &tx, rx);
-                }
+                apdu_loop(tx);
             }
             CATCH(EXCEPTION_IO_RESET) {
                 THROW(EXCEPTION_IO_RESET);
             }
             CATCH_OTHER(e) {
+                u2f_wipe_pending_request();
+                u2f_reset_stream();
+                scratch_reset();
+
                 // Exception reported by the OS, convert to internal error
                 e = 0x6800 | (e & 0x7FF);
                 tx = u2f_fill_status_code(e, G_io_apdu_buffer);
-                flags = 0;
             }
             FINALLY {
             }
@@ -176,6 +203,9 @@ void app_main(void) {
                 // Initialize U2F service
                 config_init();
 
+                // Credentials validated before an IO reset must be validated again
+                credential_cache_reset();
+
                 // request device status (charging/usbpower/etc)
                 io_seproxyhal_request_mcu_status();
 
@@ -191,6 +221,12 @@ void app_main(void) {
                 sample_main();
             }
             CATCH(EXCEPTION_IO_RESET) {
+                // The pending request, if any, is dropped
+                u2f_wipe_pending_request();
+                u2f_reset_stream();
+                crypto_presignature_pool_reset();
+                scratch_reset();
+
                 USB_power(0);  // ensure disconnecting pull before reconnecting
 
                 continue;
@@ -209,6 +245,9 @@ __attribute__((section(".boot"))) int main(void) {
     // ensure exception will work as planned
     os_boot();
 
+    // main() frame stays at the top of the stack, paint everything below
+    memory_usage_paint_stack();
+
     for (;;) {
         BEGIN_TRY {
             TRY {
@@ -0,0 +1,141 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifdef HAVE_MEMORY_USAGE
+
+#include <string.h>
+
+#include "os.h"
+#include "os_io_seproxyhal.h"
+#include "ux.h"
+
+#include "globals.h"
+#include "memory_usage.h"
+
+#define MEMORY_USAGE_VERSION 0x01
+
+#define STACK_PAINT 0xA5A5A5A5
+// Bytes kept unpainted below the painting function frame, which is still in use
+#define STACK_PAINT_MARGIN 64
+
+// Provided by the SDK link script, just below the stack
+extern unsigned int app_stack_canary;
+
+// Size of the static buffers, in the serialization order
+#define MEMORY_USAGE_STATIC_COUNT 9
+
+// Bytes of stack available below the frame painting it at boot
+static uint16_t stackSize;
+// Minimal count of painted bytes left intact per class, UINT16_MAX until measured
+static uint16_t stackMinFree[MEMORY_USAGE_CLASS_COUNT];
+
+static uint32_t *stack_bottom(void) {
+    // Skip the canary word
+    return (uint32_t *) &app_stack_canary + 1;
+}
+
+// Not inlined so that the frame of the caller is above the painted area
+static __attribute__((noinline)) uint32_t stack_paint_below_frame(void) {
+    volatile uint32_t marker = 0;
+    uint32_t *end = (uint32_t *) ((uintptr_t) &marker - STACK_PAINT_MARGIN);
+    uint32_t *p;
+
+    for (p = stack_bottom(); p < end; p++) {
+        *p = STACK_PAINT;
+    }
+    return (p - stack_bottom()) * sizeof(uint32_t);
+}
+
+static uint32_t stack_count_free(void) {
+    uint32_t *p = stack_bottom();
+
+    while (*p == STACK_PAINT) {
+        p++;
+    }
+    return (p - stack_bottom()) * sizeof(uint32_t);
+}
+
+void memory_usage_paint_stack(void) {
+    uint32_t size = stack_paint_below_frame();
+
+    stackSize = (size > UINT16_MAX) ? UINT16_MAX : size;
+    memory_usage_reset();
+}
+
+void memory_usage_checkpoint(uint8_t usage_class) {
+    uint32_t freeBytes = stack_count_free();
+
+    if (freeBytes < stackMinFree[usage_class]) {
+        stackMinFree[usage_class] = freeBytes;
+    }
+    stack_paint_below_frame();
+}
+
+void memory_usage_reset(void) {
+    memset(stackMinFree, 0xFF, sizeof(stackMinFree));
+}
+
+static int memory_usage_fill_uint16(uint16_t value, uint8_t *buffer) {
+    buffer[0] = value >> 8;
+    buffer[1] = value;
+    return 2;
+}
+
+/* Serialized memory usage, all integers are big endian:
+ *
+ * | Version | Class count (C) | Stack size (uint16) |
+ * | Minimal free stack per class: C x uint16, 0xFFFF if not measured |
+ * | Static count (S) | S x uint16 |
+ *
+ * Static buffers are: shared_ctx, u2f_data_t, credential_cache_t, scratch_t,
+ * verifyHash, verifyName, G_ux, G_io_apdu_buffer and G_io_seproxyhal_spi_buffer.
+ */
+int memory_usage_serialize(uint8_t *buffer, uint32_t size) {
+    const uint16_t staticSizes[MEMORY_USAGE_STATIC_COUNT] = {
+        sizeof(shared_ctx),
+        sizeof(u2f_data_t),
+        sizeof(credential_cache_t),
+        sizeof(scratch_t),
+        sizeof(verifyHash),
+        sizeof(verifyName),
+        sizeof(G_ux),
+        sizeof(G_io_apdu_buffer),
+        sizeof(G_io_seproxyhal_spi_buffer),
+    };
+    int offset = 0;
+
+    if (size < 5 + 2 * MEMORY_USAGE_CLASS_COUNT + 2 * MEMORY_USAGE_STATIC_COUNT) {
+        return -1;
+    }
+
+    buffer[offset++] = MEMORY_USAGE_VERSION;
+    buffer[offset++] = MEMORY_USAGE_CLASS_COUNT;
+    offset += memory_usage_fill_uint16(stackSize, buffer + offset);
+    for (uint8_t i = 0; i < MEMORY_USAGE_CLASS_COUNT; i++) {
+        offset += memory_usage_fill_uint16(stackMinFree[i], buffer + offset);
+    }
+
+    buffer[offset++] = MEMORY_USAGE_STATIC_COUNT;
+    for (uint8_t i = 0; i < MEMORY_USAGE_STATIC_COUNT; i++) {
+        offset += memory_usage_fill_uint16(staticSizes[i], buffer + offset);
+    }
+
+    return offset;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#include <string.h>
+
+#include "os.h"
+
+#include "globals.h"
+#include "scratch.h"
+
+cx_sha256_t *scratch_acquire_hash(void) {
+    return &globals_get_scratch()->hash;
+}
+
+void scratch_release_hash(void) {
+    explicit_bzero(&globals_get_scratch()->hash, sizeof(cx_sha256_t));
+}
+
+cx_sha256_t *scratch_acquire_hmac(void) {
+    return &globals_get_scratch()->hmac;
+}
+
+void scratch_release_hmac(void) {
+    explicit_bzero(&globals_get_scratch()->hmac, sizeof(cx_sha256_t));
+}
+
+cx_ecfp_public_key_t *scratch_acquire_public_key(void) {
+    return &globals_get_scratch()->publicKey;
+}
+
+void scratch_release_public_key(void) {
+    explicit_bzero(&globals_get_scratch()->publicKey, sizeof(cx_ecfp_public_key_t));
+}
+
+cx_ecfp_private_key_t *scratch_acquire_private_key(void) {
+    return &globals_get_scratch()->privateKey;
+}
+
+void scratch_release_private_key(void) {
+    explicit_bzero(&globals_get_scratch()->privateKey, sizeof(cx_ecfp_private_key_t));
+}
+
+void scratch_reset(void) {
+    explicit_bzero(globals_get_scratch(), sizeof(scratch_t));
+}
@@ -0,0 +1,214 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifdef HAVE_STATS
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "os.h"
+#include "cx.h"
+
+#include "config.h"
+#include "credential.h"
+#include "crypto.h"
+#include "globals.h"
+#include "stats.h"
+
+#define STATS_VERSION 0x01
+
+// Commands and status words counted individually, the others share a last row or column
+static const uint8_t STATS_INS[] = {0x01, 0x02, 0x03, 0x10, 0x40, 0x41, 0x42};
+static const uint16_t STATS_SW[] =
+    {0x9000, 0x6985, 0x6700, 0x6A80, 0x6A86, 0x6D00, 0x6E00, 0x6FFF};
+
+#define STATS_INS_COUNT sizeof(STATS_INS)
+#define STATS_SW_COUNT  (sizeof(STATS_SW) / sizeof(STATS_SW[0]))
+
+typedef struct stats_t {
+    uint16_t requests[STATS_INS_COUNT + 1][STATS_SW_COUNT + 1];
+    uint16_t histograms[STATS_HISTOGRAM_COUNT][STATS_HISTOGRAM_BUCKETS];
+    uint32_t nvmWrites;
+    uint32_t nvmBytes;
+    // Counters kept by other modules, as they were on last reset
+    uint32_t cacheHitsBase;
+    uint32_t cacheMissesBase;
+    uint32_t presignatureHitsBase;
+    uint32_t presignatureMissesBase;
+    uint32_t counterSavedWritesBase;
+} stats_t;
+
+static stats_t stats;
+
+// Request being processed
+static uint8_t requestIns;
+static bool requestPending;
+static bool requestDone;
+static uint32_t requestStartTick;
+static uint32_t requestAnsweredTick;
+
+static void stats_increment(uint16_t *counter) {
+    if (*counter != UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+static void stats_record_latency(uint8_t histogram, uint32_t ticks) {
+    uint8_t bucket = 0;
+
+    while ((ticks != 0) && (bucket < STATS_HISTOGRAM_BUCKETS - 1)) {
+        ticks >>= 1;
+        bucket++;
+    }
+    stats_increment(&stats.histograms[histogram][bucket]);
+}
+
+static uint8_t stats_ins_index(uint8_t ins) {
+    uint8_t i;
+
+    for (i = 0; i < STATS_INS_COUNT; i++) {
+        if (STATS_INS[i] == ins) {
+            break;
+        }
+    }
+    return i;
+}
+
+static uint8_t stats_sw_index(uint16_t status_word) {
+    uint8_t i;
+
+    for (i = 0; i < STATS_SW_COUNT; i++) {
+        if (STATS_SW[i] == status_word) {
+            break;
+        }
+    }
+    return i;
+}
+
+void stats_request_start(uint8_t ins) {
+    requestIns = ins;
+    requestPending = false;
+    requestDone = false;
+    requestStartTick = tickCount;
+    requestAnsweredTick = tickCount;
+}
+
+void stats_request_prompted(void) {
+    requestPending = true;
+    stats_record_latency(STATS_HISTOGRAM_PARSE_TO_PROMPT, tickCount - requestStartTick);
+}
+
+void stats_user_presence_answered(void) {
+    requestAnsweredTick = tickCount;
+}
+
+void stats_request_done(uint16_t status_word) {
+    // Without user presence check, a response may be reported twice
+    if (requestDone) {
+        return;
+    }
+    requestDone = true;
+
+    if (requestPending) {
+        stats_record_latency(STATS_HISTOGRAM_CONFIRM_TO_RESPONSE, tickCount - requestAnsweredTick);
+        requestPending = false;
+    }
+    stats_record_latency(STATS_HISTOGRAM_REQUEST, tickCount - requestStartTick);
+    stats_increment(&stats.requests[stats_ins_index(requestIns)][stats_sw_index(status_word)]);
+}
+
+void stats_nvm_write(uint32_t length) {
+    stats.nvmWrites++;
+    stats.nvmBytes += length;
+}
+
+void stats_reset(void) {
+    explicit_bzero(&stats, sizeof(stats));
+    credential_cache_get_stats(&stats.cacheHitsBase, &stats.cacheMissesBase);
+    crypto_presignature_get_stats(&stats.presignatureHitsBase, &stats.presignatureMissesBase);
+    stats.counterSavedWritesBase = config_get_counter_saved_writes();
+}
+
+static int stats_fill_uint16(uint16_t value, uint8_t *buffer) {
+    buffer[0] = value >> 8;
+    buffer[1] = value;
+    return 2;
+}
+
+static int stats_fill_uint32(uint32_t value, uint8_t *buffer) {
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+    return 4;
+}
+
+/* Serialized statistics, all integers are big endian:
+ *
+ * | Version | INS count (I) | SW count (S) | INS list | SW list (uint16) |
+ * | Requests per INS and SW: (I + 1) x (S + 1) uint16, others last |
+ * | Histogram count (H) | Bucket count (B) | H x B uint16 |
+ * | NVM writes | NVM bytes | Cache hits | Cache misses |
+ * | Presignature hits | Presignature misses | Counter saved writes |  (uint32)
+ */
+int stats_serialize(uint8_t *buffer, uint32_t size) {
+    uint32_t hits, misses;
+    int offset = 0;
+
+    if (size < 3 + STATS_INS_COUNT + 2 * STATS_SW_COUNT + sizeof(stats.requests) + 2 +
+                   sizeof(stats.histograms) + 7 * 4) {
+        return -1;
+    }
+
+    buffer[offset++] = STATS_VERSION;
+    buffer[offset++] = STATS_INS_COUNT;
+    buffer[offset++] = STATS_SW_COUNT;
+    memcpy(buffer + offset, STATS_INS, STATS_INS_COUNT);
+    offset += STATS_INS_COUNT;
+    for (uint8_t i = 0; i < STATS_SW_COUNT; i++) {
+        offset += stats_fill_uint16(STATS_SW[i], buffer + offset);
+    }
+    for (uint8_t i = 0; i < STATS_INS_COUNT + 1; i++) {
+        for (uint8_t j = 0; j < STATS_SW_COUNT + 1; j++) {
+            offset += stats_fill_uint16(stats.requests[i][j], buffer + offset);
+        }
+    }
+
+    buffer[offset++] = STATS_HISTOGRAM_COUNT;
+    buffer[offset++] = STATS_HISTOGRAM_BUCKETS;
+    for (uint8_t i = 0; i < STATS_HISTOGRAM_COUNT; i++) {
+        for (uint8_t j = 0; j < STATS_HISTOGRAM_BUCKETS; j++) {
+            offset += stats_fill_uint16(stats.histograms[i][j], buffer + offset);
+        }
+    }
+
+    offset += stats_fill_uint32(stats.nvmWrites, buffer + offset);
+    offset += stats_fill_uint32(stats.nvmBytes, buffer + offset);
+    credential_cache_get_stats(&hits, &misses);
+    offset += stats_fill_uint32(hits - stats.cacheHitsBase, buffer + offset);
+    offset += stats_fill_uint32(misses - stats.cacheMissesBase, buffer + offset);
+    crypto_presignature_get_stats(&hits, &misses);
+    offset += stats_fill_uint32(hits - stats.presignatureHitsBase, buffer + offset);
+    offset += stats_fill_uint32(misses - stats.presignatureMissesBase, buffer + offset);
+    offset += stats_fill_uint32(config_get_counter_saved_writes() - stats.counterSavedWritesBase,
+                                buffer + offset);
+
+    return offset;
+}
+
+#endif
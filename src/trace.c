@@ -0,0 +1,118 @@
+/*
+*******************************************************************************
+*   Ledger App FIDO U2F
+*   (c) 2022 Ledger
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*   limitations under the License.
+********************************************************************************/
+
+#ifdef HAVE_TRACE
+
+#include <string.h>
+
+#include "os.h"
+
+#include "globals.h"
+#include "trace.h"
+
+#define TRACE_VERSION     0x01
+#define TRACE_RING_SIZE   64
+#define TRACE_RECORD_SIZE 7
+
+typedef struct trace_record_t {
+    uint32_t tick;
+    uint16_t arg;
+    uint8_t event;
+} trace_record_t;
+
+static trace_record_t ring[TRACE_RING_SIZE];
+// Number of records added since the last clear, the latest ones are in the ring
+static uint32_t recordCount;
+// recordCount when page 0 was last serialized, later pages stop there so that
+// the records added by the dump APDUs themselves don't shift the pages
+static uint32_t dumpEnd;
+
+void trace_record(uint8_t event, uint16_t arg) {
+    trace_record_t *record = &ring[recordCount % TRACE_RING_SIZE];
+
+    // 100 ms resolution, see trace.h
+    record->tick = tickCount;
+    record->arg = arg;
+    record->event = event;
+    recordCount++;
+}
+
+void trace_clear(void) {
+    explicit_bzero(ring, sizeof(ring));
+    recordCount = 0;
+    dumpEnd = 0;
+}
+
+static int trace_fill_uint32(uint32_t value, uint8_t *buffer) {
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+    return 4;
+}
+
+/* Serialized page, all integers are big endian:
+ *
+ * | Version | Record count (N) | Records added since clear (uint32) |
+ * | Sequence number of the first record (uint32) |
+ * | N x (Tick (uint32) | Event | Arg (uint16)) |
+ *
+ * Sequence numbers count records since the last clear, a gap with the previous
+ * page means records were overwritten while dumping.
+ */
+int trace_serialize_page(uint8_t page, uint8_t *buffer, uint32_t size) {
+    uint32_t first, end;
+    int offset = 0;
+
+    if (size < 10 + TRACE_PAGE_RECORDS * TRACE_RECORD_SIZE) {
+        return -1;
+    }
+
+    if (page == 0) {
+        dumpEnd = recordCount;
+    }
+
+    // Oldest record present when page 0 was serialized, and still present now
+    first = (dumpEnd > TRACE_RING_SIZE) ? dumpEnd - TRACE_RING_SIZE : 0;
+    first += (uint32_t) page * TRACE_PAGE_RECORDS;
+    if ((recordCount > TRACE_RING_SIZE) && (first < recordCount - TRACE_RING_SIZE)) {
+        first = recordCount - TRACE_RING_SIZE;
+    }
+    end = (first < dumpEnd) ? dumpEnd : first;
+    if (end - first > TRACE_PAGE_RECORDS) {
+        end = first + TRACE_PAGE_RECORDS;
+    }
+
+    buffer[offset++] = TRACE_VERSION;
+    buffer[offset++] = end - first;
+    offset += trace_fill_uint32(recordCount, buffer + offset);
+    offset += trace_fill_uint32(first, buffer + offset);
+
+    for (uint32_t i = first; i < end; i++) {
+        trace_record_t *record = &ring[i % TRACE_RING_SIZE];
+
+        offset += trace_fill_uint32(record->tick, buffer + offset);
+        buffer[offset++] = record->event;
+        buffer[offset++] = record->arg >> 8;
+        buffer[offset++] = record->arg;
+    }
+
+    return offset;
+}
+
+#endif
@@ -32,9 +32,14 @@
 #include "crypto.h"
 #include "crypto_data.h"
 #include "credential.h"
+#include "ctap2.h"
 #include "ui_shared.h"
 #include "globals.h"
 #include "fido_known_apps.h"
+#include "stats.h"
+#include "trace.h"
+#include "memory_usage.h"
+#include "scratch.h"
 
 #define U2F_VERSION      "U2F_V2"
 #define U2F_VERSION_SIZE (sizeof(U2F_VERSION) - 1)
@@ -46,15 +51,51 @@
 #define OFFSET_DATA 7
 
 #define FIDO_CLA             0x00
+#define FIDO_CLA_CHAINING    0x10
 #define FIDO_INS_ENROLL      0x01
 #define FIDO_INS_SIGN        0x02
 #define FIDO_INS_GET_VERSION 0x03
 #define FIDO_INS_CTAP2_PROXY 0x10
 
+// Proprietary: check a list of key handles at once
+#define FIDO_INS_CHECK_KEY_HANDLES 0x40
+// Proprietary: load a known apps directory in NVM
+#define FIDO_INS_LOAD_KNOWN_APPS 0x41
+// Proprietary: read or reset request statistics
+#define FIDO_INS_GET_STATS 0x42
+// Proprietary: dump the request timeline trace
+#define FIDO_INS_GET_TRACE 0x43
+// Proprietary: read or reset stack and static RAM usage
+#define FIDO_INS_GET_MEMORY_USAGE 0x44
+// Proprietary: echo or generate data without any processing, to measure the transport
+#define FIDO_INS_LOOPBACK 0x45
+
 #define P1_U2F_CHECK_IS_REGISTERED    0x07
 #define P1_U2F_REQUEST_USER_PRESENCE  0x03
 #define P1_U2F_OPTIONAL_USER_PRESENCE 0x08
 
+// Proprietary: request a compact key handle on enroll
+#define P2_U2F_COMPACT_KEY_HANDLE 0x01
+
+#define P1_GET_STATS_READ  0x00
+#define P1_GET_STATS_RESET 0x01
+
+// P1 of FIDO_INS_GET_TRACE is the page index
+#define P2_GET_TRACE_READ  0x00
+#define P2_GET_TRACE_CLEAR 0x01
+
+#define P1_GET_MEMORY_USAGE_READ  0x00
+#define P1_GET_MEMORY_USAGE_RESET 0x01
+
+#define P1_LOOPBACK_ECHO     0x00
+#define P1_LOOPBACK_GENERATE 0x01
+
+#define P1_LOAD_KNOWN_APPS_BEGIN   0x00
+#define P1_LOAD_KNOWN_APPS_RECORDS 0x01
+#define P1_LOAD_KNOWN_APPS_NAMES   0x02
+#define P1_LOAD_KNOWN_APPS_COMMIT  0x03
+#define P1_LOAD_KNOWN_APPS_INFO    0x04
+
 #define SW_NO_ERROR                 0x9000
 #define SW_WRONG_LENGTH             0x6700
 #define SW_CONDITIONS_NOT_SATISFIED 0x6985
@@ -67,8 +108,19 @@
 #define U2F_ENROLL_RESERVED 0x05
 static const uint8_t DUMMY_ZERO[] = {0x00};
 #define SIGN_USER_PRESENCE_MASK 0x01
+
+// Presignatures are only computed once no APDU was received for this long
+#define PRESIGNATURE_IDLE_TICKS 5  // about 500 ms
+
+static uint32_t lastActivityTick;
 static const uint8_t DUMMY_USER_PRESENCE[] = {SIGN_USER_PRESENCE_MASK};
 
+// Pending user presence requests are cancelled after this delay, 0 to disable
+#ifndef U2F_USER_PRESENCE_TIMEOUT_S
+#define U2F_USER_PRESENCE_TIMEOUT_S 30
+#endif
+#define U2F_USER_PRESENCE_TIMEOUT_TICKS (U2F_USER_PRESENCE_TIMEOUT_S * 10)
+
 /********************************************************************/
 /*  Temporary definition of u2f_get_cmd_msg_data_length             */
 /*                                                                  */
@@ -175,9 +227,9 @@ typedef struct u2f_reg_req_t {
 // __attribute__((__packed__)) not necessary as we use only uint8_t
 typedef struct u2f_reg_resp_base_t {
     uint8_t reserved_byte;
-    uint8_t user_key[65];
+    uint8_t user_key[U2F_USER_KEY_SIZE];
     uint8_t key_handle_length;
-    uint8_t key_handle[CREDENTIAL_MINIMAL_SIZE];  // We generate fix size key handles
+    // key handle: not in this base struct due to not const length
     // attestation certificate: not in this base struct due to not const length
     // signature: not in this base struct due to not const offset nor length
 } u2f_reg_resp_base_t;
@@ -217,6 +269,22 @@ typedef struct u2f_auth_resp_base_t {
 /*         U2F response helpers           */
 /******************************************/
 
+#ifdef HAVE_KNOWN_APPS_NVM
+static int u2f_fill_uint16(uint16_t value, uint8_t *buffer) {
+    buffer[0] = value >> 8;
+    buffer[1] = value;
+    return 2;
+}
+
+static int u2f_fill_uint32(uint32_t value, uint8_t *buffer) {
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+    return 4;
+}
+#endif
+
 static int u2f_fill_status_code(uint16_t status_code, uint8_t *buffer) {
     buffer[0] = status_code >> 8;
     buffer[1] = status_code;
@@ -227,92 +295,212 @@ static void u2f_send_error(uint16_t status_code, unsigned short *tx) {
     *tx = u2f_fill_status_code(status_code, G_io_apdu_buffer);
 }
 
-static void u2f_compute_enroll_response_hash(u2f_reg_resp_base_t *reg_resp_base,
-                                             uint16_t key_handle_length,
-                                             uint8_t *data_hash) {
-    cx_sha256_t hash;
-
-    cx_sha256_init(&hash);
-    cx_hash(&hash.header, 0, DUMMY_ZERO, 1, NULL, 0);
-    cx_hash(&hash.header,
-            0,
-            globals_get_u2f_data()->application_param,
-            sizeof(globals_get_u2f_data()->application_param),
-            NULL,
-            0);
-    cx_hash(&hash.header,
-            0,
-            globals_get_u2f_data()->challenge_param,
-            sizeof(globals_get_u2f_data()->challenge_param),
-            NULL,
-            0);
-    cx_hash(&hash.header, 0, reg_resp_base->key_handle, key_handle_length, NULL, 0);
-    cx_hash(&hash.header,
-            CX_LAST,
-            reg_resp_base->user_key,
-            sizeof(reg_resp_base->user_key),
-            data_hash,
-            CX_SHA256_SIZE);
+/* CTAP2 responses are a status byte followed, on success, by the CBOR response.
+ * CTAP2 errors are reported with this status byte and SW_NO_ERROR.
+ */
+static int u2f_fill_ctap2_status(uint8_t status) {
+    G_io_apdu_buffer[0] = status;
+    return 1 + u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + 1);
 }
 
-static int u2f_prepare_enroll_response(void) {
-    int offset = 0;
-    int result = -1;
-    int key_handle_length;
+static void u2f_send_ctap2_error(uint8_t status, unsigned short *tx) {
+    *tx = u2f_fill_ctap2_status(status);
+}
+
+/**
+ * Fill the status byte and code of a CBOR response written after the status byte.
+ */
+static int u2f_fill_ctap2_response(const cbor_writer_t *writer) {
+    if (writer->overflow) {
+        return u2f_fill_ctap2_status(CTAP1_ERR_OTHER);
+    }
+    G_io_apdu_buffer[0] = CTAP2_OK;
+    return 1 + writer->offset +
+           u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + 1 + writer->offset);
+}
 
-    u2f_reg_resp_base_t *reg_resp_base = (u2f_reg_resp_base_t *) G_io_apdu_buffer;
-    offset += sizeof(u2f_reg_resp_base_t);
+void u2f_reset_stream(void) {
+    explicit_bzero(globals_get_u2f_stream(), sizeof(u2f_stream_t));
+}
 
-    // Fill reserved byte
-    reg_resp_base->reserved_byte = U2F_ENROLL_RESERVED;
+void u2f_wipe_pending_request(void) {
+    // Drops the request type, its parameters, the private key and the partial enroll response
+    explicit_bzero(globals_get_u2f_data(), sizeof(u2f_data_t));
+    lastActivityTick = tickCount;
+}
 
-    // Generate nonce
-    cx_rng_no_throw(globals_get_u2f_data()->nonce, CREDENTIAL_NONCE_SIZE);
+static cx_err_t u2f_compute_enroll_response_hash(const uint8_t *user_key,
+                                                 const uint8_t *key_handle,
+                                                 uint16_t key_handle_length,
+                                                 uint8_t *data_hash) {
+    cx_sha256_t *hash = scratch_acquire_hash();
+    cx_err_t error;
+
+    CX_CHECK(cx_sha256_init_no_throw(hash));
+    CX_CHECK(cx_hash_no_throw(&hash->header, 0, DUMMY_ZERO, 1, NULL, 0));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              0,
+                              globals_get_u2f_data()->application_param,
+                              sizeof(globals_get_u2f_data()->application_param),
+                              NULL,
+                              0));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              0,
+                              globals_get_u2f_data()->challenge_param,
+                              sizeof(globals_get_u2f_data()->challenge_param),
+                              NULL,
+                              0));
+    CX_CHECK(cx_hash_no_throw(&hash->header, 0, key_handle, key_handle_length, NULL, 0));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              CX_LAST,
+                              user_key,
+                              U2F_USER_KEY_SIZE,
+                              data_hash,
+                              CX_SHA256_SIZE));
+
+end:
+    scratch_release_hash();
+    return error;
+}
 
-    // Generate private and public key and fill public key
-    {
-        cx_ecfp_private_key_t private_key;
+static int u2f_enroll_generate_key_pair(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    cx_ecfp_private_key_t *private_key = scratch_acquire_private_key();
+    int result = 0;
+
+    // Generate nonce, its length was chosen when parsing the request
+    cx_rng_no_throw(u2f_data->nonce, u2f_data->nonce_length);
+
+    // Generate private and public key
+    if (crypto_generate_private_key(u2f_data->nonce,
+                                    u2f_data->nonce_length,
+                                    private_key,
+                                    CX_CURVE_SECP256R1) != 0) {
+        result = -1;
+    } else if (crypto_generate_public_key(private_key,
+                                          u2f_data->enroll_user_key,
+                                          CX_CURVE_SECP256R1) != U2F_USER_KEY_SIZE) {
+        result = -1;
+    }
+    trace_record(TRACE_EVENT_KEY_DERIVED, (result == 0) ? 0 : 1);
 
-        if (crypto_generate_private_key(globals_get_u2f_data()->nonce,
-                                        &private_key,
-                                        CX_CURVE_SECP256R1) != 0) {
-            goto exit;
-        }
-        if (crypto_generate_public_key(&private_key, reg_resp_base->user_key, CX_CURVE_SECP256R1) <=
-            0) {
-            explicit_bzero(&private_key, sizeof(private_key));
-            goto exit;
-        }
+    scratch_release_private_key();
+    return result;
+}
 
-        // Generate key handle
-        // This also generate nonce needed for public key generation
-        key_handle_length = credential_wrap(globals_get_u2f_data()->application_param,
-                                            globals_get_u2f_data()->nonce,
-                                            &private_key,
-                                            reg_resp_base->key_handle,
-                                            sizeof(reg_resp_base->key_handle));
+static int u2f_enroll_generate_key_handle(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
 
-        explicit_bzero(&private_key, sizeof(private_key));
+    // Its format depends on the nonce length
+    int key_handle_length = credential_wrap(u2f_data->application_param,
+                                            u2f_data->nonce,
+                                            u2f_data->nonce_length,
+                                            u2f_data->enroll_key_handle,
+                                            sizeof(u2f_data->enroll_key_handle));
+    if (key_handle_length <= 0) {
+        return -1;
     }
+    u2f_data->enroll_key_handle_length = key_handle_length;
+    return 0;
+}
 
-    // We only support generating key_handle with length of 64 bytes
-    if (key_handle_length == sizeof(reg_resp_base->key_handle)) {
-        // Fill key handle length
-        reg_resp_base->key_handle_length = key_handle_length;
+static int u2f_enroll_generate_signature(uint8_t *signature) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    uint8_t data_hash[CX_SHA256_SIZE];
+    int result;
+
+    if (u2f_compute_enroll_response_hash(u2f_data->enroll_user_key,
+                                         u2f_data->enroll_key_handle,
+                                         u2f_data->enroll_key_handle_length,
+                                         data_hash) != CX_OK) {
+        return -1;
+    }
+
+    result = crypto_sign_attestation(data_hash, signature);
+    trace_record(TRACE_EVENT_SIGNATURE_DONE, (result > 0) ? result : 0xFFFF);
+    if (result <= 0) {
+        return -1;
+    }
+    u2f_data->enroll_signature_length = result;
+    return 0;
+}
+
+/**
+ * Run the next step of the enroll response computation.
+ * Each step is short enough to run on a ticker event while the user reviews the request.
+ */
+static void u2f_enroll_next_step(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    int result = -1;
+
+    switch (u2f_data->enroll_step) {
+        case U2F_ENROLL_STEP_KEY_PAIR:
+            result = u2f_enroll_generate_key_pair();
+            break;
+        case U2F_ENROLL_STEP_KEY_HANDLE:
+            result = u2f_enroll_generate_key_handle();
+            break;
+        case U2F_ENROLL_STEP_SIGNATURE:
+            result = u2f_enroll_generate_signature(u2f_data->enroll_signature);
+            break;
+        default:
+            break;
+    }
+
+    if (result < 0) {
+        u2f_data->enroll_step = U2F_ENROLL_STEP_ERROR;
+    } else {
+        u2f_data->enroll_step++;
+    }
+}
+
+static bool u2f_enroll_in_progress(void) {
+    uint8_t step = globals_get_u2f_data()->enroll_step;
+    return (step != U2F_ENROLL_STEP_IDLE) && (step != U2F_ENROLL_STEP_DONE) &&
+           (step != U2F_ENROLL_STEP_ERROR);
+}
+
+static int u2f_prepare_enroll_response(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    int offset = 0;
+    int result = -1;
+
+    // Complete the steps that were not done while the user was reviewing the request,
+    // except the signature which is then written in place once the rest is assembled
+    while (u2f_enroll_in_progress() && (u2f_data->enroll_step != U2F_ENROLL_STEP_SIGNATURE)) {
+        u2f_enroll_next_step();
+    }
+
+    if ((u2f_data->enroll_step == U2F_ENROLL_STEP_SIGNATURE) ||
+        (u2f_data->enroll_step == U2F_ENROLL_STEP_DONE)) {
+        u2f_reg_resp_base_t *reg_resp_base = (u2f_reg_resp_base_t *) G_io_apdu_buffer;
+        offset += sizeof(u2f_reg_resp_base_t);
+
+        // Fill reserved byte, public key and key handle
+        reg_resp_base->reserved_byte = U2F_ENROLL_RESERVED;
+        memmove(reg_resp_base->user_key, u2f_data->enroll_user_key, U2F_USER_KEY_SIZE);
+        reg_resp_base->key_handle_length = u2f_data->enroll_key_handle_length;
+        memmove(G_io_apdu_buffer + offset,
+                u2f_data->enroll_key_handle,
+                u2f_data->enroll_key_handle_length);
+        offset += u2f_data->enroll_key_handle_length;
 
         // Fill attestation certificate
         memmove(G_io_apdu_buffer + offset, ATTESTATION_CERT, sizeof(ATTESTATION_CERT));
         offset += sizeof(ATTESTATION_CERT);
 
-        // Prepare signature
-        uint8_t data_hash[CX_SHA256_SIZE];
-        u2f_compute_enroll_response_hash(reg_resp_base, key_handle_length, data_hash);
-
-        // Fill signature
+        // Fill signature, computing it directly in the response if not done yet
         uint8_t *signature = (G_io_apdu_buffer + offset);
-        result = crypto_sign_attestation(data_hash, signature);
-        if (result > 0) {
-            offset += result;
+        if (u2f_data->enroll_step == U2F_ENROLL_STEP_SIGNATURE) {
+            if (u2f_enroll_generate_signature(signature) == 0) {
+                u2f_data->enroll_step = U2F_ENROLL_STEP_DONE;
+            }
+        } else {
+            memmove(signature, u2f_data->enroll_signature, u2f_data->enroll_signature_length);
+        }
+
+        if (u2f_data->enroll_step == U2F_ENROLL_STEP_DONE) {
+            offset += u2f_data->enroll_signature_length;
 
             // Fill status code
             uint8_t *status = (G_io_apdu_buffer + offset);
@@ -321,7 +509,8 @@ static int u2f_prepare_enroll_response(void) {
         }
     }
 
-exit:
+    u2f_wipe_pending_request();
+
     if (result < 0) {
         result = u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
     }
@@ -329,30 +518,78 @@ exit:
     return result;
 }
 
-static void u2f_compute_sign_response_hash(u2f_auth_resp_base_t *auth_resp_base,
-                                           uint8_t *data_hash) {
-    cx_sha256_t hash;
+static cx_err_t u2f_compute_sign_response_hash(u2f_auth_resp_base_t *auth_resp_base,
+                                               uint8_t *data_hash) {
+    cx_sha256_t *hash = scratch_acquire_hash();
+    cx_err_t error;
+
+    CX_CHECK(cx_sha256_init_no_throw(hash));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              0,
+                              globals_get_u2f_data()->application_param,
+                              sizeof(globals_get_u2f_data()->application_param),
+                              NULL,
+                              0));
+    CX_CHECK(cx_hash_no_throw(&hash->header, 0, &auth_resp_base->user_presence, 1, NULL, 0));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              0,
+                              auth_resp_base->counter,
+                              sizeof(auth_resp_base->counter),
+                              NULL,
+                              0));
+    CX_CHECK(cx_hash_no_throw(&hash->header,
+                              CX_LAST,
+                              globals_get_u2f_data()->challenge_param,
+                              sizeof(globals_get_u2f_data()->challenge_param),
+                              data_hash,
+                              CX_SHA256_SIZE));
+
+end:
+    scratch_release_hash();
+    return error;
+}
 
-    cx_sha256_init(&hash);
-    cx_hash(&hash.header,
-            0,
-            globals_get_u2f_data()->application_param,
-            sizeof(globals_get_u2f_data()->application_param),
-            NULL,
-            0);
-    cx_hash(&hash.header, 0, DUMMY_USER_PRESENCE, 1, NULL, 0);
-    cx_hash(&hash.header, 0, auth_resp_base->counter, sizeof(auth_resp_base->counter), NULL, 0);
-    cx_hash(&hash.header,
-            CX_LAST,
-            globals_get_u2f_data()->challenge_param,
-            sizeof(globals_get_u2f_data()->challenge_param),
-            data_hash,
-            CX_SHA256_SIZE);
+/**
+ * Fill the counter of a sign response whose user presence byte is set, and sign it.
+ * Return the signature length, or -1 on error.
+ */
+static int u2f_sign_response(u2f_auth_resp_base_t *auth_resp_base, uint8_t *signature) {
+    cx_ecfp_private_key_t *private_key = &globals_get_u2f_data()->private_key;
+    uint8_t data_hash[CX_SHA256_SIZE];
+    int result;
+
+    // Fill counter
+    if (config_increase_and_get_authentification_counter(auth_resp_base->counter) !=
+        sizeof(auth_resp_base->counter)) {
+        return -1;
+    }
+
+    // Prepare signature
+    if (u2f_compute_sign_response_hash(auth_resp_base, data_hash) != CX_OK) {
+        return -1;
+    }
+
+    // Generate private key if not done when the request was received
+    if (!globals_get_u2f_data()->private_key_valid) {
+        if (crypto_generate_private_key(globals_get_u2f_data()->nonce,
+                                        globals_get_u2f_data()->nonce_length,
+                                        private_key,
+                                        CX_CURVE_SECP256R1) != 0) {
+            trace_record(TRACE_EVENT_KEY_DERIVED, 1);
+            return -1;
+        }
+        trace_record(TRACE_EVENT_KEY_DERIVED, 0);
+        globals_get_u2f_data()->private_key_valid = true;
+    }
+
+    result = crypto_sign_application(data_hash, private_key, signature);
+    trace_record(TRACE_EVENT_SIGNATURE_DONE, (result > 0) ? result : 0xFFFF);
+    return (result > 0) ? result : -1;
 }
 
 static int u2f_prepare_sign_response(void) {
     int offset = 0;
-    int result = -1;
+    int result;
 
     u2f_auth_resp_base_t *auth_resp_base = (u2f_auth_resp_base_t *) G_io_apdu_buffer;
     offset += sizeof(u2f_auth_resp_base_t);
@@ -360,61 +597,158 @@ static int u2f_prepare_sign_response(void) {
     // Fill user presence byte
     auth_resp_base->user_presence = SIGN_USER_PRESENCE_MASK;
 
-    // Fill counter
-    config_increase_and_get_authentification_counter(auth_resp_base->counter);
+    // Fill counter and signature
+    result = u2f_sign_response(auth_resp_base, G_io_apdu_buffer + offset);
 
-    // Prepare signature
-    uint8_t data_hash[CX_SHA256_SIZE];
-    u2f_compute_sign_response_hash(auth_resp_base, data_hash);
+    u2f_wipe_pending_request();
 
-    // Generate private key and fill signature
-    {
-        cx_ecfp_private_key_t private_key;
-        uint8_t *signature = (G_io_apdu_buffer + offset);
+    if (result < 0) {
+        return u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
+    }
+    offset += result;
 
-        if (crypto_generate_private_key(globals_get_u2f_data()->nonce,
-                                        &private_key,
-                                        CX_CURVE_SECP256R1) != 0) {
-            goto exit;
-        }
-        result = crypto_sign_application(data_hash, &private_key, signature);
+    // Fill status code
+    uint8_t *status = (G_io_apdu_buffer + offset);
+    offset += u2f_fill_status_code(SW_NO_ERROR, status);
 
-        explicit_bzero(&private_key, sizeof(private_key));
+    return offset;
+}
 
-        if (result > 0) {
-            offset += result;
+/**
+ * Build a CTAP2 makeCredential response from the U2F enroll response parts.
+ */
+static int u2f_prepare_ctap2_make_credential_response(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    cbor_writer_t writer;
+    int result;
+
+    if (u2f_data->ctap2_excluded) {
+        u2f_wipe_pending_request();
+        return u2f_fill_ctap2_status(CTAP2_ERR_CREDENTIAL_EXCLUDED);
+    }
 
-            // Fill status code
-            uint8_t *status = (G_io_apdu_buffer + offset);
-            offset += u2f_fill_status_code(SW_NO_ERROR, status);
-            result = offset;
-        }
+    // Complete the steps that were not done while the user was reviewing the request
+    while (u2f_enroll_in_progress()) {
+        u2f_enroll_next_step();
     }
 
-exit:
-    if (result < 0) {
-        result = u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
+    if (u2f_data->enroll_step == U2F_ENROLL_STEP_DONE) {
+        cbor_writer_init(&writer, G_io_apdu_buffer + 1, sizeof(G_io_apdu_buffer) - 1 - 2);
+        ctap2_write_make_credential(&writer,
+                                    u2f_data->application_param,
+                                    u2f_data->enroll_key_handle,
+                                    u2f_data->enroll_key_handle_length,
+                                    u2f_data->enroll_user_key,
+                                    u2f_data->enroll_signature,
+                                    u2f_data->enroll_signature_length,
+                                    ATTESTATION_CERT,
+                                    sizeof(ATTESTATION_CERT));
+        result = u2f_fill_ctap2_response(&writer);
+    } else {
+        result = u2f_fill_ctap2_status(CTAP1_ERR_OTHER);
     }
 
+    u2f_wipe_pending_request();
     return result;
 }
 
+/**
+ * Build a CTAP2 getAssertion response, signed like an U2F sign response.
+ */
+static int u2f_prepare_ctap2_get_assertion_response(bool user_presence) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    u2f_auth_resp_base_t auth_resp_base;
+    // Out of the way of the CBOR response, written from the start of the buffer
+    uint8_t *signature = G_io_apdu_buffer + sizeof(G_io_apdu_buffer) - CRYPTO_SIGNATURE_MAX_SIZE;
+    cbor_writer_t writer;
+    int result;
+
+    // Same bit as the user presence flag of the authenticator data
+    auth_resp_base.user_presence = user_presence ? SIGN_USER_PRESENCE_MASK : 0;
+    result = u2f_sign_response(&auth_resp_base, signature);
+
+    if (result > 0) {
+        cbor_writer_init(&writer, G_io_apdu_buffer + 1, signature - G_io_apdu_buffer - 1 - 2);
+        ctap2_write_get_assertion(&writer,
+                                  u2f_data->application_param,
+                                  auth_resp_base.user_presence,
+                                  auth_resp_base.counter,
+                                  u2f_data->sign_key_handle,
+                                  u2f_data->sign_key_handle_length,
+                                  signature,
+                                  result);
+        result = u2f_fill_ctap2_response(&writer);
+    } else {
+        result = u2f_fill_ctap2_status(CTAP1_ERR_OTHER);
+    }
+
+    u2f_wipe_pending_request();
+    return result;
+}
+
+static uint16_t u2f_get_status_code(int tx) {
+    return (G_io_apdu_buffer[tx - 2] << 8) | G_io_apdu_buffer[tx - 1];
+}
+
+static uint8_t u2f_get_memory_usage_class(uint8_t ins) {
+    switch (ins) {
+        case FIDO_INS_ENROLL:
+            return MEMORY_USAGE_CLASS_ENROLL;
+        case FIDO_INS_SIGN:
+            return MEMORY_USAGE_CLASS_SIGN;
+        default:
+            return MEMORY_USAGE_CLASS_OTHER;
+    }
+}
+
 static int u2f_process_user_presence_confirmed(void) {
-    switch (globals_get_u2f_data()->user_presence_request_type) {
+    uint8_t request_type = globals_get_u2f_data()->user_presence_request_type;
+    bool ctap2 = globals_get_u2f_data()->ctap2;
+    int tx;
+
+    memory_usage_checkpoint(MEMORY_USAGE_CLASS_BACKGROUND);
+    trace_record(TRACE_EVENT_USER_DECISION, 1);
+    stats_user_presence_answered();
+    switch (request_type) {
         case FIDO_INS_ENROLL:
-            return u2f_prepare_enroll_response();
+            tx = ctap2 ? u2f_prepare_ctap2_make_credential_response()
+                       : u2f_prepare_enroll_response();
+            break;
 
         case FIDO_INS_SIGN:
-            return u2f_prepare_sign_response();
+            tx = ctap2 ? u2f_prepare_ctap2_get_assertion_response(true)
+                       : u2f_prepare_sign_response();
+            break;
 
         default:
+            tx = u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
             break;
     }
-    return u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
+    stats_request_done(u2f_get_status_code(tx));
+    trace_record(TRACE_EVENT_REPLY, u2f_get_status_code(tx));
+    memory_usage_checkpoint(u2f_get_memory_usage_class(request_type));
+    return tx;
 }
 
 static int u2f_process_user_presence_cancelled(void) {
-    return u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
+    uint8_t request_type = globals_get_u2f_data()->user_presence_request_type;
+    bool ctap2 = globals_get_u2f_data()->ctap2;
+    int tx;
+
+    memory_usage_checkpoint(MEMORY_USAGE_CLASS_BACKGROUND);
+    trace_record(TRACE_EVENT_USER_DECISION, 0);
+    stats_user_presence_answered();
+    u2f_wipe_pending_request();
+
+    if (ctap2) {
+        tx = u2f_fill_ctap2_status(CTAP2_ERR_OPERATION_DENIED);
+    } else {
+        tx = u2f_fill_status_code(SW_PROPRIETARY_INTERNAL, G_io_apdu_buffer);
+    }
+    stats_request_done(u2f_get_status_code(tx));
+    trace_record(TRACE_EVENT_REPLY, u2f_get_status_code(tx));
+    memory_usage_checkpoint(u2f_get_memory_usage_class(request_type));
+    return tx;
 }
 
 /******************************************/
@@ -540,6 +874,7 @@ static void u2f_review_login_choice(bool confirm) {
 static void onActionCallback(int token, uint8_t index) {
     // Release the review layout.
     nbgl_layoutRelease(layout);
+    layout = NULL;
 
     if (token == REGISTER_TOKEN) {
         u2f_review_register_choice(index == 0);
@@ -597,15 +932,45 @@ static void start_review(uint8_t token, const char *confirm_text) {
 
 #endif
 
-static void u2f_prompt_user_presence(bool enroll, uint8_t *applicationParameter) {
+/**
+ * Copy the CTAP2 rpId in verifyName. A too long one keeps its end, where the
+ * registrable domain is, and non printable characters are replaced.
+ */
+static void u2f_set_verify_name_rp_id(const char *rp_id, uint32_t rp_id_length) {
+    uint32_t offset = 0;
+
+    if (rp_id_length > sizeof(verifyName) - 1) {
+        memcpy(verifyName, "...", 3);
+        offset = 3;
+        rp_id += rp_id_length - (sizeof(verifyName) - 1 - offset);
+        rp_id_length = sizeof(verifyName) - 1 - offset;
+    }
+    for (uint32_t i = 0; i < rp_id_length; i++) {
+        verifyName[offset + i] = ((rp_id[i] >= 0x20) && (rp_id[i] <= 0x7e)) ? rp_id[i] : '?';
+    }
+    verifyName[offset + rp_id_length] = '\0';
+}
+
+/**
+ * rp_id is the rpId of a CTAP2 request, shown as is, or NULL for an U2F request
+ * which is named after the known app matching its application parameter.
+ */
+static void u2f_prompt_user_presence(bool enroll,
+                                     uint8_t *applicationParameter,
+                                     const char *rp_id,
+                                     uint32_t rp_id_length) {
     UX_WAKE_UP();
 
     snprintf(verifyHash, sizeof(verifyHash), "%.*H", 32, applicationParameter);
-    strcpy(verifyName, "Unknown");
+    if (rp_id != NULL) {
+        u2f_set_verify_name_rp_id(rp_id, rp_id_length);
+    } else {
+        strcpy(verifyName, "Unknown");
 
-    const char *name = fido_match_known_appid(applicationParameter);
-    if (name != NULL) {
-        strlcpy(verifyName, name, sizeof(verifyName));
+        const char *name = fido_match_known_appid(applicationParameter);
+        if (name != NULL) {
+            strlcpy(verifyName, name, sizeof(verifyName));
+        }
     }
 
 #if defined(HAVE_BAGL)
@@ -622,13 +987,99 @@ static void u2f_prompt_user_presence(bool enroll, uint8_t *applicationParameter)
         start_review(LOGIN_TOKEN, "Login");
     }
 #endif
+    trace_record(TRACE_EVENT_PROMPT_SHOWN, enroll);
+}
+
+static void u2f_user_presence_timeout(void) {
+    uint16_t tx = u2f_process_user_presence_cancelled();
+    io_exchange(CHANNEL_APDU | IO_RETURN_AFTER_TX, tx);
+#ifdef HAVE_NBGL
+    // Release the review layout, as when the user answers
+    nbgl_layoutRelease(layout);
+    layout = NULL;
+#endif
+    ui_idle();
+}
+
+void u2f_ticker_event(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+
+#if U2F_USER_PRESENCE_TIMEOUT_S > 0
+    // The host may have given up, don't keep the request forever
+    if ((u2f_data->user_presence_request_type != 0) &&
+        (tickCount - u2f_data->user_presence_request_tick >= U2F_USER_PRESENCE_TIMEOUT_TICKS)) {
+        return u2f_user_presence_timeout();
+    }
+#endif
+
+    if (u2f_enroll_in_progress()) {
+        u2f_enroll_next_step();
+    } else if ((u2f_data->user_presence_request_type == 0) &&
+               (tickCount - lastActivityTick >= PRESIGNATURE_IDLE_TICKS)) {
+        crypto_presignature_pool_refill();
+    }
 }
 
 /******************************************/
 /*           U2F APDU handlers            */
 /******************************************/
 
+/**
+ * Ask the user to confirm the request stored in u2f_data, the response is then
+ * sent asynchronously. rp_id is the rpId of a CTAP2 request, NULL otherwise.
+ */
+static void u2f_request_user_presence(unsigned char *flags,
+                                      unsigned short *tx,
+                                      uint8_t request_type,
+                                      const char *rp_id,
+                                      uint32_t rp_id_length) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+
+    u2f_data->user_presence_request_type = request_type;
+    u2f_data->user_presence_request_tick = tickCount;
+#ifndef HAVE_NO_USER_PRESENCE_CHECK
+    UNUSED(tx);
+    // CTAP2 hosts wait for the response rather than polling with retries
+    if ((G_io_u2f.media == U2F_MEDIA_USB) && !u2f_data->ctap2) {
+        u2f_message_set_autoreply_wait_user_presence(&G_io_u2f, true);
+    }
+    u2f_prompt_user_presence(request_type == FIDO_INS_ENROLL,
+                             u2f_data->application_param,
+                             rp_id,
+                             rp_id_length);
+    *flags |= IO_ASYNCH_REPLY;
+#else
+#warning Having no user presence check is against U2F standard
+    UNUSED(flags);
+    UNUSED(rp_id);
+    UNUSED(rp_id_length);
+    *tx = u2f_process_user_presence_confirmed();
+#endif
+}
+
+/**
+ * Derive the private key of the pending sign request now rather than after the user confirms.
+ * On failure, derivation will be tried again when preparing the response.
+ */
+static void u2f_derive_sign_private_key(void) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+
+    if (crypto_generate_private_key(u2f_data->nonce,
+                                    u2f_data->nonce_length,
+                                    &u2f_data->private_key,
+                                    CX_CURVE_SECP256R1) == 0) {
+        trace_record(TRACE_EVENT_KEY_DERIVED, 0);
+        u2f_data->private_key_valid = true;
+    } else {
+        trace_record(TRACE_EVENT_KEY_DERIVED, 1);
+        explicit_bzero(&u2f_data->private_key, sizeof(u2f_data->private_key));
+    }
+}
+
 static void u2f_handle_apdu_enroll(unsigned char *flags, unsigned short *tx, uint32_t data_length) {
+    // A new request replaces any pending one
+    u2f_wipe_pending_request();
+
     // Parse request and check length validity
     u2f_reg_req_t *reg_req = (u2f_reg_req_t *) (G_io_apdu_buffer + OFFSET_DATA);
     if (data_length != sizeof(u2f_reg_req_t)) {
@@ -647,8 +1098,15 @@ static void u2f_handle_apdu_enroll(unsigned char *flags, unsigned short *tx, uin
         }
     }
     // Check P2
-    if (G_io_apdu_buffer[OFFSET_P2] != 0) {
-        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    switch (G_io_apdu_buffer[OFFSET_P2]) {
+        case 0:
+            globals_get_u2f_data()->nonce_length = CREDENTIAL_NONCE_SIZE;
+            break;
+        case P2_U2F_COMPACT_KEY_HANDLE:
+            globals_get_u2f_data()->nonce_length = CREDENTIAL_COMPACT_NONCE_SIZE;
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
     }
 
     // Backup challenge and application parameters to be used if user accept the request
@@ -659,21 +1117,15 @@ static void u2f_handle_apdu_enroll(unsigned char *flags, unsigned short *tx, uin
             reg_req->application_param,
             sizeof(reg_req->application_param));
 
-#ifndef HAVE_NO_USER_PRESENCE_CHECK
-    globals_get_u2f_data()->user_presence_request_type = G_io_apdu_buffer[OFFSET_INS];
-    if (G_io_u2f.media == U2F_MEDIA_USB) {
-        u2f_message_set_autoreply_wait_user_presence(&G_io_u2f, true);
-    }
-    u2f_prompt_user_presence(true, globals_get_u2f_data()->application_param);
-    *flags |= IO_ASYNCH_REPLY;
-#else
-#warning Having no user presence check is against U2F standard
-    *tx = u2f_process_user_presence_confirmed();
-#endif
+    // The response is computed on ticker events while the user reviews the request
+    globals_get_u2f_data()->enroll_step = U2F_ENROLL_STEP_KEY_PAIR;
+
+    u2f_request_user_presence(flags, tx, FIDO_INS_ENROLL, NULL, 0);
 }
 
 static void u2f_handle_apdu_sign(unsigned char *flags, unsigned short *tx, uint32_t data_length) {
     uint8_t *nonce;
+    int nonce_length;
     // Parse request base and check length validity
     u2f_auth_req_base_t *auth_req_base = (u2f_auth_req_base_t *) (G_io_apdu_buffer + OFFSET_DATA);
     if (data_length < sizeof(u2f_auth_req_base_t)) {
@@ -706,10 +1158,12 @@ static void u2f_handle_apdu_sign(unsigned char *flags, unsigned short *tx, uint3
 
     // Check the key handle validity immediately
     // Store the nonce in globals u2f_data for response generation
-    if (credential_unwrap(auth_req_base->application_param,
-                          key_handle,
-                          auth_req_base->key_handle_length,
-                          &nonce) < 0) {
+    nonce_length = credential_unwrap(auth_req_base->application_param,
+                                     key_handle,
+                                     auth_req_base->key_handle_length,
+                                     &nonce);
+    trace_record(TRACE_EVENT_UNWRAP_DONE, (nonce_length >= 0) ? nonce_length : 0xFFFF);
+    if (nonce_length < 0) {
         return u2f_send_error(SW_WRONG_DATA, tx);
     }
 
@@ -718,8 +1172,14 @@ static void u2f_handle_apdu_sign(unsigned char *flags, unsigned short *tx, uint3
         return u2f_send_error(SW_CONDITIONS_NOT_SATISFIED, tx);
     }
 
+    // A new request replaces any pending one
+    u2f_wipe_pending_request();
+
     // Backup nonce, challenge and application parameters to be used if user accept the request
-    memmove(globals_get_u2f_data()->nonce, nonce, CREDENTIAL_NONCE_SIZE);
+    memmove(globals_get_u2f_data()->nonce, nonce, nonce_length);
+    globals_get_u2f_data()->nonce_length = nonce_length;
+
+    u2f_derive_sign_private_key();
     memmove(globals_get_u2f_data()->challenge_param,
             auth_req_base->challenge_param,
             sizeof(auth_req_base->challenge_param));
@@ -727,17 +1187,7 @@ static void u2f_handle_apdu_sign(unsigned char *flags, unsigned short *tx, uint3
             auth_req_base->application_param,
             sizeof(auth_req_base->application_param));
 
-#ifndef HAVE_NO_USER_PRESENCE_CHECK
-    globals_get_u2f_data()->user_presence_request_type = G_io_apdu_buffer[OFFSET_INS];
-    if (G_io_u2f.media == U2F_MEDIA_USB) {
-        u2f_message_set_autoreply_wait_user_presence(&G_io_u2f, true);
-    }
-    u2f_prompt_user_presence(false, globals_get_u2f_data()->application_param);
-    *flags |= IO_ASYNCH_REPLY;
-#else
-#warning Having no user presence check is against U2F standard
-    *tx = u2f_process_user_presence_confirmed();
-#endif
+    u2f_request_user_presence(flags, tx, FIDO_INS_SIGN, NULL, 0);
 }
 
 static void u2f_handle_apdu_get_version(unsigned char *flags,
@@ -766,15 +1216,528 @@ static void u2f_handle_apdu_get_version(unsigned char *flags,
     *tx = offset;
 }
 
-void handleApdu(unsigned char *flags, unsigned short *tx, unsigned short length) {
-    PRINTF("Media handleApdu %d\n", G_io_app.apdu_state);
+static void u2f_handle_ctap2_get_info(unsigned short *tx) {
+    cbor_writer_t writer;
+
+    cbor_writer_init(&writer, G_io_apdu_buffer + 1, sizeof(G_io_apdu_buffer) - 1 - 2);
+    ctap2_write_get_info(&writer);
+    *tx = u2f_fill_ctap2_response(&writer);
+}
 
+/**
+ * makeCredential is an U2F enroll of a v2 credential, with a CTAP2 response.
+ */
+static void u2f_handle_ctap2_make_credential(unsigned char *flags,
+                                             unsigned short *tx,
+                                             const uint8_t *data,
+                                             uint32_t length) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    uint8_t rp_id_hash[CX_SHA256_SIZE];
+    ctap2_request_t request;
+    const uint8_t *id;
+    uint32_t id_length;
+    uint8_t status;
+
+    status = ctap2_parse_make_credential(data, length, &request);
+    if (status != CTAP2_OK) {
+        return u2f_send_ctap2_error(status, tx);
+    }
+    if (ctap2_compute_rp_id_hash(&request, rp_id_hash) != CX_OK) {
+        return u2f_send_ctap2_error(CTAP1_ERR_OTHER, tx);
+    }
+
+    // A new request replaces any pending one
+    u2f_wipe_pending_request();
+    u2f_data->ctap2 = true;
+    u2f_data->nonce_length = CREDENTIAL_NONCE_SIZE;
+    memmove(u2f_data->challenge_param, request.client_data_hash, CTAP2_CLIENT_DATA_HASH_SIZE);
+    memmove(u2f_data->application_param, rp_id_hash, sizeof(rp_id_hash));
+
+    // Credentials are not stored, an excluded one is recognized by unwrapping it.
+    // As required by CTAP2, the error is only returned after the user presence
+    // check, so that the host can't probe for credentials silently.
+    for (uint32_t i = 0; (i < request.credentials_count) && !u2f_data->ctap2_excluded; i++) {
+        ctap2_next_credential(&request, &id, &id_length);
+        if ((id != NULL) && (credential_unwrap(rp_id_hash, (uint8_t *) id, id_length, NULL) >= 0)) {
+            u2f_data->ctap2_excluded = true;
+        }
+    }
+
+    // The response is computed on ticker events while the user reviews the request
+    if (!u2f_data->ctap2_excluded) {
+        u2f_data->enroll_step = U2F_ENROLL_STEP_KEY_PAIR;
+    }
+
+    u2f_request_user_presence(flags, tx, FIDO_INS_ENROLL, request.rp_id, request.rp_id_length);
+}
+
+/**
+ * getAssertion is an U2F sign with the first credential of the allowList
+ * which was generated by this device, all of them being checked at once.
+ */
+static void u2f_handle_ctap2_get_assertion(unsigned char *flags,
+                                           unsigned short *tx,
+                                           const uint8_t *data,
+                                           uint32_t length) {
+    u2f_data_t *u2f_data = globals_get_u2f_data();
+    uint8_t rp_id_hash[CX_SHA256_SIZE];
+    ctap2_request_t request;
+    const uint8_t *id = NULL;
+    uint32_t id_length = 0;
+    uint8_t *nonce;
+    int nonce_length = -1;
+    uint8_t status;
+
+    status = ctap2_parse_get_assertion(data, length, &request);
+    if (status != CTAP2_OK) {
+        return u2f_send_ctap2_error(status, tx);
+    }
+    if (ctap2_compute_rp_id_hash(&request, rp_id_hash) != CX_OK) {
+        return u2f_send_ctap2_error(CTAP1_ERR_OTHER, tx);
+    }
+
+    // Without resident keys, only the credentials of the allowList can be used
+    for (uint32_t i = 0; (i < request.credentials_count) && (nonce_length < 0); i++) {
+        ctap2_next_credential(&request, &id, &id_length);
+        if (id != NULL) {
+            nonce_length = credential_unwrap(rp_id_hash, (uint8_t *) id, id_length, &nonce);
+        }
+    }
+    trace_record(TRACE_EVENT_UNWRAP_DONE, (nonce_length >= 0) ? nonce_length : 0xFFFF);
+    if (nonce_length < 0) {
+        return u2f_send_ctap2_error(CTAP2_ERR_NO_CREDENTIALS, tx);
+    }
+
+    // A new request replaces any pending one
+    u2f_wipe_pending_request();
+    u2f_data->ctap2 = true;
+
+    // Backup nonce, client data hash and rpIdHash to be used if user accept the request
+    memmove(u2f_data->nonce, nonce, nonce_length);
+    u2f_data->nonce_length = nonce_length;
+    u2f_derive_sign_private_key();
+    memmove(u2f_data->challenge_param, request.client_data_hash, CTAP2_CLIENT_DATA_HASH_SIZE);
+    memmove(u2f_data->application_param, rp_id_hash, sizeof(rp_id_hash));
+    // The credential is valid, therefore not longer than CREDENTIAL_MAX_SIZE
+    memmove(u2f_data->sign_key_handle, id, id_length);
+    u2f_data->sign_key_handle_length = id_length;
+
+    // The "up" option false asks for an assertion without user presence check
+    if (!request.user_presence) {
+        *tx = u2f_prepare_ctap2_get_assertion_response(false);
+        return;
+    }
+
+    u2f_request_user_presence(flags, tx, FIDO_INS_SIGN, request.rp_id, request.rp_id_length);
+}
+
+/**
+ * Request data is a CTAP2 command byte followed by its CBOR parameters.
+ */
+static void u2f_handle_apdu_ctap2(unsigned char *flags, unsigned short *tx, uint32_t data_length) {
+    const uint8_t *data = G_io_apdu_buffer + OFFSET_DATA;
+
+    if ((G_io_apdu_buffer[OFFSET_P1] != 0) || (G_io_apdu_buffer[OFFSET_P2] != 0)) {
+        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    if (data_length == 0) {
+        return u2f_send_ctap2_error(CTAP1_ERR_INVALID_LENGTH, tx);
+    }
+
+    switch (data[0]) {
+        case CTAP2_CMD_GET_INFO:
+            if (data_length != 1) {
+                return u2f_send_ctap2_error(CTAP1_ERR_INVALID_LENGTH, tx);
+            }
+            u2f_handle_ctap2_get_info(tx);
+            break;
+        case CTAP2_CMD_MAKE_CREDENTIAL:
+            u2f_handle_ctap2_make_credential(flags, tx, data + 1, data_length - 1);
+            break;
+        case CTAP2_CMD_GET_ASSERTION:
+            u2f_handle_ctap2_get_assertion(flags, tx, data + 1, data_length - 1);
+            break;
+        default:
+            return u2f_send_ctap2_error(CTAP1_ERR_INVALID_COMMAND, tx);
+    }
+}
+
+/**
+ * Request data is the application parameter followed by a list of key handles,
+ * each one prefixed by its length:
+ *
+ * +-------------------+----------+--------------+-----+----------+--------------+
+ * | application param | KH 0 len | Key handle 0 | ... | KH n len | Key handle n |
+ * +-------------------+----------+--------------+-----+----------+--------------+
+ * | 32 B              | 1 B      | var          |     | 1 B      | var          |
+ * +-------------------+----------+--------------+-----+----------+--------------+
+ *
+ * Response data is a bitmap of ceil(n / 8) bytes, where bit (i % 8) of byte
+ * (i / 8) is set when key handle i was generated by this device for this
+ * application parameter.
+ */
+/**
+ * Consume a chunk of a check key handles request, checking each key handle as
+ * soon as it is complete.
+ * Return 0 on success, -1 if there are too many key handles.
+ */
+static int u2f_check_key_handles_consume(u2f_check_key_handles_stream_t *state,
+                                         const uint8_t *data,
+                                         uint32_t length) {
+    while (length > 0) {
+        uint32_t chunk;
+
+        if (state->application_param_length < sizeof(state->application_param)) {
+            chunk = MIN(length, sizeof(state->application_param) - state->application_param_length);
+            memcpy(state->application_param + state->application_param_length, data, chunk);
+            state->application_param_length += chunk;
+            data += chunk;
+            length -= chunk;
+            continue;
+        }
+
+        if (!state->key_handle_started) {
+            if (state->count == CHECK_KEY_HANDLES_MAX_COUNT) {
+                return -1;
+            }
+            state->key_handle_started = true;
+            state->key_handle_length = data[0];
+            state->key_handle_received = 0;
+            data += 1;
+            length -= 1;
+        } else {
+            chunk = MIN(length, (uint32_t) (state->key_handle_length - state->key_handle_received));
+            // Longer key handles are invalid, only their length matters
+            if (state->key_handle_received < sizeof(state->key_handle)) {
+                memcpy(state->key_handle + state->key_handle_received,
+                       data,
+                       MIN(chunk, sizeof(state->key_handle) - state->key_handle_received));
+            }
+            state->key_handle_received += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+
+        if (state->key_handle_received == state->key_handle_length) {
+            if ((state->key_handle_length <= sizeof(state->key_handle)) &&
+                (credential_unwrap(state->application_param,
+                                   state->key_handle,
+                                   state->key_handle_length,
+                                   NULL) >= 0)) {
+                state->bitmap[state->count / 8] |= 1 << (state->count % 8);
+            }
+            state->key_handle_started = false;
+            state->count += 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Check up to CHECK_KEY_HANDLES_MAX_COUNT key handles at once.
+ * Request data is: application parameter (32 B) | key handle length (1 B) | key handle | ...
+ * It may be split in several chained APDUs, response data is a bitmap of the valid key handles.
+ */
+static void u2f_handle_apdu_check_key_handles(unsigned char *flags,
+                                              unsigned short *tx,
+                                              uint32_t data_length) {
+    UNUSED(flags);
+
+    u2f_stream_t *stream = globals_get_u2f_stream();
+    u2f_check_key_handles_stream_t *state = &stream->u.checkKeyHandles;
+    bool last = (G_io_apdu_buffer[OFFSET_CLA] & FIDO_CLA_CHAINING) == 0;
+    uint32_t offset;
+
+    if (!stream->active) {
+        if ((G_io_apdu_buffer[OFFSET_P1] != 0) || (G_io_apdu_buffer[OFFSET_P2] != 0)) {
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+        }
+        u2f_reset_stream();
+        if (!last) {
+            stream->active = true;
+            stream->ins = G_io_apdu_buffer[OFFSET_INS];
+            stream->p1 = G_io_apdu_buffer[OFFSET_P1];
+            stream->p2 = G_io_apdu_buffer[OFFSET_P2];
+        }
+    }
+
+    if ((u2f_check_key_handles_consume(state, G_io_apdu_buffer + OFFSET_DATA, data_length) !=
+         0) ||
+        (last && ((state->application_param_length != sizeof(state->application_param)) ||
+                  state->key_handle_started))) {
+        u2f_reset_stream();
+        return u2f_send_error(SW_WRONG_LENGTH, tx);
+    }
+
+    if (!last) {
+        *tx = u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer);
+        return;
+    }
+
+    // Fill bitmap
+    offset = (state->count + 7) / 8;
+    memmove(G_io_apdu_buffer, state->bitmap, offset);
+    u2f_reset_stream();
+
+    // Fill status code
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+
+    *tx = offset;
+}
+
+#ifdef HAVE_KNOWN_APPS_NVM
+/**
+ * Load a known apps directory signed by the vendor in NVM, see fido_known_apps.h
+ * for its format. Depending on P1, request data is:
+ * - BEGIN:   directory header
+ * - RECORDS: index of the first record (2 B) | records
+ * - NAMES:   offset in the names area (2 B) | names
+ * - COMMIT:  DER encoded signature of the directory
+ * - INFO:    empty, response data is:
+ *            records count (2 B) | max records count (2 B) | max names area size (2 B) |
+ *            version (4 B)
+ * All integers are big endian.
+ */
+static void u2f_handle_apdu_load_known_apps(unsigned char *flags,
+                                            unsigned short *tx,
+                                            uint32_t data_length) {
+    UNUSED(flags);
+
+    uint8_t *data = G_io_apdu_buffer + OFFSET_DATA;
+    int offset = 0;
+    int status;
+
+    if (G_io_apdu_buffer[OFFSET_P2] != 0) {
+        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    switch (G_io_apdu_buffer[OFFSET_P1]) {
+        case P1_LOAD_KNOWN_APPS_BEGIN:
+            status = fido_known_apps_load_begin(data, data_length);
+            break;
+        case P1_LOAD_KNOWN_APPS_RECORDS:
+            if (data_length < 2) {
+                return u2f_send_error(SW_WRONG_LENGTH, tx);
+            }
+            status = fido_known_apps_load_records(U2BE(data, 0), data + 2, data_length - 2);
+            break;
+        case P1_LOAD_KNOWN_APPS_NAMES:
+            if (data_length < 2) {
+                return u2f_send_error(SW_WRONG_LENGTH, tx);
+            }
+            status = fido_known_apps_load_names(U2BE(data, 0), data + 2, data_length - 2);
+            break;
+        case P1_LOAD_KNOWN_APPS_COMMIT:
+            status = fido_known_apps_load_commit(data, data_length);
+            break;
+        case P1_LOAD_KNOWN_APPS_INFO:
+            if (data_length != 0) {
+                return u2f_send_error(SW_WRONG_LENGTH, tx);
+            }
+            offset += u2f_fill_uint16(fido_known_apps_nvm_count(), G_io_apdu_buffer + offset);
+            offset += u2f_fill_uint16(FIDO_KNOWN_APPS_NVM_MAX_COUNT, G_io_apdu_buffer + offset);
+            offset += u2f_fill_uint16(FIDO_KNOWN_APPS_NVM_NAMES_SIZE, G_io_apdu_buffer + offset);
+            offset += u2f_fill_uint32(fido_known_apps_nvm_version(), G_io_apdu_buffer + offset);
+            status = 0;
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    if (status < 0) {
+        return u2f_send_error(SW_WRONG_DATA, tx);
+    }
+
+    // Fill status code
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+
+    *tx = offset;
+}
+#endif
+
+#ifdef HAVE_STATS
+static void u2f_handle_apdu_get_stats(unsigned char *flags,
+                                      unsigned short *tx,
+                                      uint32_t data_length) {
+    UNUSED(flags);
+
+    int offset = 0;
+
+    if (data_length != 0) {
+        return u2f_send_error(SW_WRONG_LENGTH, tx);
+    }
+
+    if (G_io_apdu_buffer[OFFSET_P2] != 0) {
+        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    switch (G_io_apdu_buffer[OFFSET_P1]) {
+        case P1_GET_STATS_READ: {
+            // Leave room for the status code
+            int result = stats_serialize(G_io_apdu_buffer, sizeof(G_io_apdu_buffer) - 2);
+            if (result < 0) {
+                return u2f_send_error(SW_PROPRIETARY_INTERNAL, tx);
+            }
+            offset += result;
+            break;
+        }
+        case P1_GET_STATS_RESET:
+            stats_reset();
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+    *tx = offset;
+}
+#endif
+
+#ifdef HAVE_TRACE
+static void u2f_handle_apdu_get_trace(unsigned char *flags,
+                                      unsigned short *tx,
+                                      uint32_t data_length) {
+    UNUSED(flags);
+
+    int offset = 0;
+
+    if (data_length != 0) {
+        return u2f_send_error(SW_WRONG_LENGTH, tx);
+    }
+
+    switch (G_io_apdu_buffer[OFFSET_P2]) {
+        case P2_GET_TRACE_READ: {
+            // Leave room for the status code
+            int result = trace_serialize_page(G_io_apdu_buffer[OFFSET_P1],
+                                              G_io_apdu_buffer,
+                                              sizeof(G_io_apdu_buffer) - 2);
+            if (result < 0) {
+                return u2f_send_error(SW_PROPRIETARY_INTERNAL, tx);
+            }
+            offset += result;
+            break;
+        }
+        case P2_GET_TRACE_CLEAR:
+            if (G_io_apdu_buffer[OFFSET_P1] != 0) {
+                return u2f_send_error(SW_INCORRECT_P1P2, tx);
+            }
+            trace_clear();
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+    *tx = offset;
+}
+#endif
+
+#ifdef HAVE_MEMORY_USAGE
+static void u2f_handle_apdu_get_memory_usage(unsigned char *flags,
+                                             unsigned short *tx,
+                                             uint32_t data_length) {
+    UNUSED(flags);
+
+    int offset = 0;
+
+    if (data_length != 0) {
+        return u2f_send_error(SW_WRONG_LENGTH, tx);
+    }
+
+    if (G_io_apdu_buffer[OFFSET_P2] != 0) {
+        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    switch (G_io_apdu_buffer[OFFSET_P1]) {
+        case P1_GET_MEMORY_USAGE_READ: {
+            // Leave room for the status code
+            int result = memory_usage_serialize(G_io_apdu_buffer, sizeof(G_io_apdu_buffer) - 2);
+            if (result < 0) {
+                return u2f_send_error(SW_PROPRIETARY_INTERNAL, tx);
+            }
+            offset += result;
+            break;
+        }
+        case P1_GET_MEMORY_USAGE_RESET:
+            memory_usage_reset();
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+    *tx = offset;
+}
+#endif
+
+#ifdef HAVE_LOOPBACK
+/**
+ * Echo the request data (P1_LOOPBACK_ECHO), or answer the number of bytes
+ * given as a big endian uint16 in the request data (P1_LOOPBACK_GENERATE).
+ */
+static void u2f_handle_apdu_loopback(unsigned char *flags,
+                                     unsigned short *tx,
+                                     uint32_t data_length) {
+    UNUSED(flags);
+
+    uint32_t offset;
+
+    if (G_io_apdu_buffer[OFFSET_P2] != 0) {
+        return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    switch (G_io_apdu_buffer[OFFSET_P1]) {
+        case P1_LOOPBACK_ECHO:
+            offset = data_length;
+            memmove(G_io_apdu_buffer, G_io_apdu_buffer + OFFSET_DATA, offset);
+            break;
+        case P1_LOOPBACK_GENERATE:
+            if (data_length != 2) {
+                return u2f_send_error(SW_WRONG_LENGTH, tx);
+            }
+            offset = U2BE(G_io_apdu_buffer, OFFSET_DATA);
+            // Leave room for the status code
+            if (offset > sizeof(G_io_apdu_buffer) - 2) {
+                return u2f_send_error(SW_WRONG_DATA, tx);
+            }
+            for (uint32_t i = 0; i < offset; i++) {
+                G_io_apdu_buffer[i] = i;
+            }
+            break;
+        default:
+            return u2f_send_error(SW_INCORRECT_P1P2, tx);
+    }
+
+    offset += u2f_fill_status_code(SW_NO_ERROR, G_io_apdu_buffer + offset);
+    *tx = offset;
+}
+#endif
+
+static void u2f_dispatch_apdu(unsigned char *flags, unsigned short *tx, unsigned short length) {
     int data_length = u2f_get_cmd_msg_data_length(G_io_apdu_buffer, length);
     if (data_length < 0) {
         return u2f_send_error(SW_WRONG_LENGTH, tx);
     }
+    trace_record(TRACE_EVENT_LENGTH_PARSED, data_length);
+
+    u2f_stream_t *stream = globals_get_u2f_stream();
+    // Any other command aborts the chained request being received
+    if (stream->active && ((G_io_apdu_buffer[OFFSET_INS] != stream->ins) ||
+                           (G_io_apdu_buffer[OFFSET_P1] != stream->p1) ||
+                           (G_io_apdu_buffer[OFFSET_P2] != stream->p2))) {
+        PRINTF("chained request aborted\n");
+        u2f_reset_stream();
+    }
 
-    if (G_io_apdu_buffer[OFFSET_CLA] != FIDO_CLA) {
+    if (G_io_apdu_buffer[OFFSET_CLA] == FIDO_CLA_CHAINING) {
+        if (G_io_apdu_buffer[OFFSET_INS] != FIDO_INS_CHECK_KEY_HANDLES) {
+            u2f_reset_stream();
+            return u2f_send_error(SW_CLA_NOT_SUPPORTED, tx);
+        }
+    } else if (G_io_apdu_buffer[OFFSET_CLA] != FIDO_CLA) {
+        u2f_reset_stream();
         return u2f_send_error(SW_CLA_NOT_SUPPORTED, tx);
     }
 
@@ -791,8 +1754,65 @@ void handleApdu(unsigned char *flags, unsigned short *tx, unsigned short length)
             PRINTF("version\n");
             u2f_handle_apdu_get_version(flags, tx, data_length);
             break;
+        case FIDO_INS_CTAP2_PROXY:
+            PRINTF("ctap2\n");
+            u2f_handle_apdu_ctap2(flags, tx, data_length);
+            break;
+        case FIDO_INS_CHECK_KEY_HANDLES:
+            PRINTF("check key handles\n");
+            u2f_handle_apdu_check_key_handles(flags, tx, data_length);
+            break;
+#ifdef HAVE_KNOWN_APPS_NVM
+        case FIDO_INS_LOAD_KNOWN_APPS:
+            PRINTF("load known apps\n");
+            u2f_handle_apdu_load_known_apps(flags, tx, data_length);
+            break;
+#endif
+#ifdef HAVE_STATS
+        case FIDO_INS_GET_STATS:
+            PRINTF("stats\n");
+            u2f_handle_apdu_get_stats(flags, tx, data_length);
+            break;
+#endif
+#ifdef HAVE_TRACE
+        case FIDO_INS_GET_TRACE:
+            PRINTF("trace\n");
+            u2f_handle_apdu_get_trace(flags, tx, data_length);
+            break;
+#endif
+#ifdef HAVE_MEMORY_USAGE
+        case FIDO_INS_GET_MEMORY_USAGE:
+            PRINTF("memory usage\n");
+            u2f_handle_apdu_get_memory_usage(flags, tx, data_length);
+            break;
+#endif
+#ifdef HAVE_LOOPBACK
+        case FIDO_INS_LOOPBACK:
+            PRINTF("loopback\n");
+            u2f_handle_apdu_loopback(flags, tx, data_length);
+            break;
+#endif
         default:
             PRINTF("unsupported\n");
             return u2f_send_error(SW_INS_NOT_SUPPORTED, tx);
     }
 }
+
+void handleApdu(unsigned char *flags, unsigned short *tx, unsigned short length) {
+    // The response overwrites the request
+    uint8_t ins = G_io_apdu_buffer[OFFSET_INS];
+
+    PRINTF("Media handleApdu %d\n", G_io_app.apdu_state);
+
+    lastActivityTick = tickCount;
+
+    memory_usage_checkpoint(MEMORY_USAGE_CLASS_BACKGROUND);
+    stats_request_start(ins);
+    u2f_dispatch_apdu(flags, tx, length);
+    if (*flags & IO_ASYNCH_REPLY) {
+        stats_request_prompted();
+    } else {
+        stats_request_done(u2f_get_status_code(*tx));
+    }
+    memory_usage_checkpoint(u2f_get_memory_usage_class(ins));
+}
@@ -17,11 +17,15 @@
 ********************************************************************************/
 
 #include "ux.h"
+#include "cx.h"
 
 #include "glyphs.h"
+#include "crypto.h"
 #include "ui_shared.h"
 
 static void app_quit(void) {
+    crypto_presignature_pool_reset();
+
 #ifdef REVAMPED_IO
     // handle properly the USB stop/start
     os_io_stop();
@@ -0,0 +1,32 @@
+import pytest
+import sys
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from ctap1_client import APDU
+from utils import measure_latency, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 500
+
+
+def test_benchmark_get_version_flood(client: TestClient):
+    # GET_VERSION does almost nothing, so this measures the per-APDU overhead
+    # of the IO loop and the dispatch
+    def get_version():
+        assert client.ctap1.get_version() == "U2F_V2"
+
+    print_latency("get version", measure_latency(get_version, ITERATIONS))
+
+
+def test_benchmark_error_flood(client: TestClient):
+    # Same for a request rejected by the dispatch
+    def unsupported_ins():
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=0x50)
+        assert e.value.code == APDU.SW_INS_NOT_SUPPORTED
+
+    print_latency("unsupported ins", measure_latency(unsupported_ins, ITERATIONS))
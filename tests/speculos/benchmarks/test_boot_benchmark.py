@@ -0,0 +1,76 @@
+import pytest
+import socket
+import sys
+import time
+
+from fido2.ctap1 import ApduError, Ctap1
+from fido2.hid import CTAPHID
+
+from client import TestClient
+from ctap1_client import APDU
+from utils import generate_random_bytes, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 5
+POLL_TIMEOUT = 0.05
+
+
+def wait_until_ready(client: TestClient, start: float):
+    # The app is ready once it answers a GET_VERSION request.
+    # Poll with a short receive timeout, requests sent while the app is not
+    # ready are lost.
+    sock = client.dev._connection.sock
+    sock.settimeout(POLL_TIMEOUT)
+    try:
+        while True:
+            try:
+                client.ctap1.get_version()
+                return time.perf_counter() - start
+            except (socket.timeout, ConnectionError):
+                pass
+    finally:
+        sock.settimeout(5)
+
+
+def test_benchmark_power_on(client: TestClient):
+    # Includes speculos own start time, which does not depend on the app:
+    # only compare results of two runs on the same host.
+    samples = []
+    for _ in range(ITERATIONS):
+        start = time.perf_counter()
+        client.simulate_reboot()
+        samples.append(wait_until_ready(client, start))
+
+    print_latency("power-on to ready", samples)
+
+
+def test_benchmark_io_reset(client: TestClient):
+    # A changed request received while waiting for user presence on the U2F
+    # endpoint triggers an EXCEPTION_IO_RESET, then config_init() runs again
+    if not client.use_U2F_endpoint:
+        pytest.skip("Does not work with this transport")
+
+    samples = []
+    for _ in range(ITERATIONS):
+        challenge = bytearray(generate_random_bytes(32))
+        app_param = generate_random_bytes(32)
+
+        client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=challenge + app_param)
+        response = client.ctap1.device.recv(CTAPHID.MSG)
+        with pytest.raises(ApduError) as e:
+            client.ctap1.parse_response(response)
+        assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+        client.ctap1.confirm()
+
+        # Change challenge first bit
+        challenge[0] ^= 0x40
+        start = time.perf_counter()
+        client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=challenge + app_param)
+        samples.append(wait_until_ready(client, start))
+
+        client.ctap1.wait_for_return_on_dashboard()
+
+    print_latency("reset to re-enumerated", samples)
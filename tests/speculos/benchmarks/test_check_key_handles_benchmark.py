@@ -0,0 +1,47 @@
+import pytest
+import sys
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from ctap1_client import APDU
+from utils import generate_random_bytes, measure_latency, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 20
+
+
+@pytest.mark.parametrize("count", [1, 4, 8])
+def test_benchmark_check_key_handles(client: TestClient, count: int):
+    # A platform looking for the right credential among `count` registered
+    # ones, the valid one being the last tried.
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    registration_data.verify(app_param, challenge)
+
+    key_handles = [generate_random_bytes(65) for _ in range(count - 1)]
+    key_handles.append(registration_data.key_handle)
+
+    def per_handle_loop():
+        for key_handle in key_handles:
+            with pytest.raises(ApduError) as e:
+                client.ctap1.authenticate(challenge,
+                                          app_param,
+                                          key_handle,
+                                          check_only=True,
+                                          user_accept=None)
+            if e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED:
+                break
+            assert e.value.code == APDU.SW_WRONG_DATA
+
+    def batch():
+        result = client.ctap1.check_key_handles(app_param, key_handles)
+        assert result == [False] * (count - 1) + [True]
+
+    print_latency("per-handle check-only x{}".format(count),
+                  measure_latency(per_handle_loop, ITERATIONS))
+    print_latency("batch check x{}".format(count),
+                  measure_latency(batch, ITERATIONS))
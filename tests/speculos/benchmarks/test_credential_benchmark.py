@@ -0,0 +1,110 @@
+import pytest
+import struct
+import sys
+import time
+
+from fido2.ctap1 import ApduError, Ctap1, RegistrationData, SignatureData
+from fido2.hid import CTAPHID
+
+from client import TestClient
+from ctap1_client import APDU, U2F_P1
+from utils import generate_random_bytes, measure_latency, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 50
+
+
+def register(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    registration_data.verify(app_param, challenge)
+
+    return app_param, registration_data
+
+
+def test_benchmark_check_only(client: TestClient):
+    # Each check-only request runs credential_unwrap() and nothing else
+    app_param, registration_data = register(client)
+    challenge = generate_random_bytes(32)
+
+    def check_only():
+        with pytest.raises(ApduError) as e:
+            client.ctap1.authenticate(challenge,
+                                      app_param,
+                                      registration_data.key_handle,
+                                      check_only=True,
+                                      user_accept=None)
+        assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    print_latency("check-only", measure_latency(check_only, ITERATIONS))
+
+
+def test_benchmark_sign_after_confirm(client: TestClient):
+    # Time between the user confirmation and the reception of the response,
+    # which covers u2f_prepare_sign_response().
+    app_param, registration_data = register(client)
+    key_handle = registration_data.key_handle
+
+    samples = []
+    for _ in range(10):
+        challenge = generate_random_bytes(32)
+        data = challenge + app_param + struct.pack(">B", len(key_handle)) + key_handle
+
+        client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                      p1=U2F_P1.REQUEST_USER_PRESENCE, data=data)
+        if client.use_U2F_endpoint:
+            # Device answers "user presence required" until the user confirms
+            response = client.ctap1.device.recv(CTAPHID.MSG)
+            with pytest.raises(ApduError):
+                client.ctap1.parse_response(response)
+
+        client.ctap1.confirm()
+        start = time.perf_counter()
+        if client.use_U2F_endpoint:
+            client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                          p1=U2F_P1.REQUEST_USER_PRESENCE, data=data)
+        response = client.ctap1.device.recv(CTAPHID.MSG)
+        samples.append(time.perf_counter() - start)
+
+        client.ctap1.wait_for_return_on_dashboard(dismiss=True)
+        authentication_data = SignatureData(client.ctap1.parse_response(response))
+        authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+    print_latency("sign after confirm", samples)
+
+
+def test_benchmark_register_after_confirm(client: TestClient):
+    # Time between the user confirmation and the reception of the response.
+    # The response is computed on ticker events while the review is displayed,
+    # so confirming only copies it to the APDU buffer.
+    samples = []
+    for _ in range(10):
+        challenge = generate_random_bytes(32)
+        app_param = generate_random_bytes(32)
+        data = challenge + app_param
+
+        client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+        if client.use_U2F_endpoint:
+            # Device answers "user presence required" until the user confirms
+            response = client.ctap1.device.recv(CTAPHID.MSG)
+            with pytest.raises(ApduError):
+                client.ctap1.parse_response(response)
+
+        # Leave the device the time a user would take to read the review
+        time.sleep(0.5)
+
+        client.ctap1.confirm()
+        start = time.perf_counter()
+        if client.use_U2F_endpoint:
+            client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+        response = client.ctap1.device.recv(CTAPHID.MSG)
+        samples.append(time.perf_counter() - start)
+
+        client.ctap1.wait_for_return_on_dashboard(dismiss=True)
+        registration_data = RegistrationData(client.ctap1.parse_response(response))
+        registration_data.verify(app_param, challenge)
+
+    print_latency("register after confirm", samples)
@@ -0,0 +1,57 @@
+import pytest
+import sys
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from ctap1_client import APDU
+from utils import ctaphid_frame_count, generate_random_bytes, measure_latency, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 50
+
+# CLA | INS | P1 | P2 | Lc (3 bytes, extended length) and Le (2 bytes)
+APDU_OVERHEAD = 7 + 2
+
+
+def authenticate_request_size(key_handle):
+    return APDU_OVERHEAD + 32 + 32 + 1 + len(key_handle)
+
+
+def register_response_size(registration_data):
+    return len(registration_data) + 2
+
+
+@pytest.mark.parametrize("compact", [False, True], ids=["v2", "compact"])
+def test_benchmark_key_handle_size(client: TestClient, compact: bool):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param,
+                                              compact_key_handle=compact)
+    registration_data.verify(app_param, challenge)
+    key_handle = registration_data.key_handle
+
+    request_size = authenticate_request_size(key_handle)
+    response_size = register_response_size(registration_data)
+    print("key handle {} bytes: authenticate request {} bytes ({} frames), "
+          "register response {} bytes ({} frames)".format(
+              len(key_handle),
+              request_size, ctaphid_frame_count(request_size),
+              response_size, ctaphid_frame_count(response_size)))
+
+    if compact:
+        assert ctaphid_frame_count(request_size) == 2
+
+    def check_only():
+        with pytest.raises(ApduError) as e:
+            client.ctap1.authenticate(challenge,
+                                      app_param,
+                                      key_handle,
+                                      check_only=True,
+                                      user_accept=None)
+        assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    name = "check-only, {}-byte key handle".format(len(key_handle))
+    print_latency(name, measure_latency(check_only, ITERATIONS))
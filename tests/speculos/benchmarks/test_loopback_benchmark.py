@@ -0,0 +1,52 @@
+import pytest
+import sys
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU_MAX_DATA_SIZE
+from utils import ctaphid_frame_count, generate_random_bytes, measure_latency, print_latency
+
+pytestmark = pytest.mark.skipif("--benchmark" not in sys.argv,
+                                reason="benchmarks only run with --benchmark")
+
+ITERATIONS = 100
+
+# CLA | INS | P1 | P2 | Lc (3 bytes, extended length) and Le (2 bytes)
+APDU_OVERHEAD = 7 + 2
+
+# Sizes around the CTAPHID init and continuation frame payloads, up to the buffer limit
+SIZES = [0, 48, 57, 116, 256, 512, APDU_MAX_DATA_SIZE]
+
+
+@pytest.fixture(autouse=True)
+def loopback_supported(client: TestClient, features: set):
+    require_feature(features, "loopback")
+
+
+def print_throughput(name, samples, request_size, response_size):
+    frames = ctaphid_frame_count(request_size) + ctaphid_frame_count(response_size)
+    print("{}: {} frames per round trip, {:.0f} frames/s".format(
+          name, frames, frames * len(samples) / sum(samples)))
+    print_latency(name, samples)
+
+
+@pytest.mark.parametrize("size", SIZES)
+def test_benchmark_loopback_echo(client: TestClient, size: int):
+    # Payload in both directions
+    data = generate_random_bytes(size)
+
+    def echo():
+        assert client.ctap1.loopback_echo(data) == data
+
+    print_throughput("echo {} bytes".format(size), measure_latency(echo, ITERATIONS),
+                     APDU_OVERHEAD + size, size + 2)
+
+
+@pytest.mark.parametrize("size", SIZES)
+def test_benchmark_loopback_generate(client: TestClient, size: int):
+    # Payload in the response only
+    def generate():
+        assert len(client.ctap1.loopback_generate(size)) == size
+
+    print_throughput("generate {} bytes".format(size), measure_latency(generate, ITERATIONS),
+                     APDU_OVERHEAD + 2, size + 2)
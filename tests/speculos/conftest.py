@@ -35,10 +35,21 @@ pytest_plugins = ("ragger.conftest.base_conftest", )
 
 BACKENDS = ["speculos"]
 
+# Optional features, compiled in with the matching Makefile flag
+FEATURES = {
+    "known_apps_nvm": "KNOWN_APPS_NVM=1",
+    "stats": "STATS=1",
+    "trace": "TRACE=1",
+    "memory_usage": "MEMORY_USAGE=1",
+    "loopback": "LOOPBACK=1",
+}
+
 
 def pytest_addoption(parser):
     parser.addoption("--transport", default="U2F")
     parser.addoption("--fast", action="store_true")
+    parser.addoption("--benchmark", action="store_true")
+    parser.addoption("--features", default="")
 
 
 @pytest.fixture(scope="session")
@@ -46,6 +57,21 @@ def transport(pytestconfig):
     return pytestconfig.getoption("transport")
 
 
+@pytest.fixture(scope="session")
+def features(pytestconfig):
+    features = set(f for f in pytestconfig.getoption("features").split(",") if f)
+    unknown = features - FEATURES.keys()
+    if unknown:
+        raise ValueError(f"Unknown features {unknown}. Valid features are: {list(FEATURES)}")
+    return features
+
+
+def require_feature(features: set, feature: str):
+    if feature not in features:
+        pytest.skip(f"Not compiled in, build with {FEATURES[feature]} and run with "
+                    f"--features {feature}")
+
+
 def prepare_speculos_args(root_pytest_dir: Path, device: Device, display: bool, transport: str):
     speculos_args = ["--usb", transport]
 
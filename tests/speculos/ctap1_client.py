@@ -6,10 +6,14 @@ from ledgered.devices import Device, DeviceType
 
 from ragger.navigator import Navigator, NavInsID
 
+from cryptography.hazmat.primitives import hashes
+from cryptography.hazmat.primitives.asymmetric import ec
+
 from fido2.ctap1 import Ctap1, ApduError, RegistrationData, SignatureData
 from fido2.hid import CTAPHID
 from fido2.ctap import CtapDevice
 
+from trace_decoder import parse_trace_page
 from utils import prepare_apdu
 
 
@@ -32,12 +36,150 @@ class APDU(IntEnum):
     SW_PROPRIETARY_INTERNAL = 0x6FFF,
 
 
+# ISO7816 command chaining: set on all the APDUs of a request but the last one
+CLA_CHAINING = 0x10
+
+# CUSTOM_IO_APDU_BUFFER_SIZE, holding the whole APDU
+APDU_BUFFER_SIZE = 1031
+
+# Largest data sent in a single APDU, with the extended length header and Le
+APDU_MAX_DATA_SIZE = APDU_BUFFER_SIZE - 7 - 2
+
+
+class U2F_INS(IntEnum):
+    # CTAP2 request carried in the APDU data
+    CTAP2_PROXY = 0x10
+    # Proprietary: check a list of key handles at once
+    CHECK_KEY_HANDLES = 0x40
+    # Proprietary: load a known apps directory in NVM
+    LOAD_KNOWN_APPS = 0x41
+    # Proprietary: read or reset request statistics
+    GET_STATS = 0x42
+    # Proprietary: dump the request timeline trace
+    GET_TRACE = 0x43
+    # Proprietary: read or reset stack and static RAM usage
+    GET_MEMORY_USAGE = 0x44
+    # Proprietary: echo or generate data, to measure the transport
+    LOOPBACK = 0x45
+
+
+class LOAD_KNOWN_APPS_P1(IntEnum):
+    BEGIN = 0x00
+    RECORDS = 0x01
+    NAMES = 0x02
+    COMMIT = 0x03
+    INFO = 0x04
+
+
+class GET_STATS_P1(IntEnum):
+    READ = 0x00
+    RESET = 0x01
+
+
+class GET_TRACE_P2(IntEnum):
+    READ = 0x00
+    CLEAR = 0x01
+
+
+class GET_MEMORY_USAGE_P1(IntEnum):
+    READ = 0x00
+    RESET = 0x01
+
+
+class LOOPBACK_P1(IntEnum):
+    ECHO = 0x00
+    GENERATE = 0x01
+
+
+MEMORY_USAGE_CLASSES = ["background", "enroll", "sign", "other"]
+MEMORY_USAGE_STATICS = ["shared_ctx", "u2f_data", "credential_cache", "scratch", "verify_hash",
+                        "verify_name", "ux", "apdu_buffer", "seproxyhal_buffer"]
+
+
+def parse_memory_usage(data: bytes):
+    """Parse the GET_MEMORY_USAGE response, the stack used per class is None
+    when it was not measured"""
+    version, class_count, stack_size = struct.unpack_from(">BBH", data)
+    assert version == 1
+    offset = 4
+    min_free = struct.unpack_from(">{}H".format(class_count), data, offset)
+    offset += 2 * class_count
+    static_count = data[offset]
+    offset += 1
+    static_sizes = struct.unpack_from(">{}H".format(static_count), data, offset)
+    offset += 2 * static_count
+    assert offset == len(data)
+
+    return {
+        "stack_size": stack_size,
+        "stack_used": {name: None if free == 0xFFFF else stack_size - free
+                       for name, free in zip(MEMORY_USAGE_CLASSES, min_free)},
+        "static": dict(zip(MEMORY_USAGE_STATICS, static_sizes)),
+    }
+
+
+STATS_HISTOGRAMS = ["parse_to_prompt", "confirm_to_response", "request"]
+STATS_COUNTERS = ["nvm_writes", "nvm_bytes", "cache_hits", "cache_misses",
+                  "presignature_hits", "presignature_misses", "counter_saved_writes"]
+
+
+def parse_stats(data: bytes):
+    """Parse the GET_STATS response, INS and status words not tracked
+    individually are reported under the None key"""
+    version, ins_count, sw_count = struct.unpack_from(">BBB", data)
+    assert version == 1
+    offset = 3
+    ins_list = list(data[offset:offset + ins_count]) + [None]
+    offset += ins_count
+    sw_list = list(struct.unpack_from(">{}H".format(sw_count), data, offset)) + [None]
+    offset += 2 * sw_count
+
+    stats = {"requests": {}}
+    for ins in ins_list:
+        counts = struct.unpack_from(">{}H".format(len(sw_list)), data, offset)
+        offset += 2 * len(sw_list)
+        stats["requests"][ins] = dict(zip(sw_list, counts))
+
+    histogram_count, bucket_count = struct.unpack_from(">BB", data, offset)
+    offset += 2
+    for name in STATS_HISTOGRAMS[:histogram_count]:
+        stats[name] = list(struct.unpack_from(">{}H".format(bucket_count), data, offset))
+        offset += 2 * bucket_count
+
+    counters = struct.unpack_from(">{}I".format(len(STATS_COUNTERS)), data, offset)
+    offset += 4 * len(STATS_COUNTERS)
+    stats.update(zip(STATS_COUNTERS, counters))
+    assert offset == len(data)
+
+    return stats
+
+
+KNOWN_APPS_PREFIX_SIZE = 8
+KNOWN_APPS_RECORD_SIZE = KNOWN_APPS_PREFIX_SIZE + 2
+# Version (uint32) | Records count (uint16) | Names area size (uint16)
+KNOWN_APPS_HEADER = ">IHH"
+
+# Test key signing the known apps directories, matching the public key the app
+# is built with unless PROD_KNOWN_APPS_PUBLIC_KEY is set
+KNOWN_APPS_TEST_SIGNING_KEY = 0x3aa044cd95ad0da3d1e095a14a769e3af41f04cf06955404a1a2ae962ffee62a
+
+
+def sign_known_apps_directory(directory: bytes, key: int = KNOWN_APPS_TEST_SIGNING_KEY):
+    private_key = ec.derive_private_key(key, ec.SECP256R1())
+    return private_key.sign(directory, ec.ECDSA(hashes.SHA256()))
+
+
 class U2F_P1(IntEnum):
     CHECK_IS_REGISTERED = 0x07
     REQUEST_USER_PRESENCE = 0x03
     OPTIONAL_USER_PRESENCE = 0x08
 
 
+class U2F_P2(IntEnum):
+    # Proprietary: request a compact key handle on register
+    COMPACT_KEY_HANDLE = 0x01
+
+
 class LedgerCtap1(Ctap1):
     """ Overriding fido2.ctap1.Ctap1
 
@@ -95,12 +237,13 @@ class LedgerCtap1(Ctap1):
         self.device.send(CTAPHID.MSG, apdu)
 
     def register(self, client_param: bytes, app_param: bytes, user_accept: bool = True,
-                 check_screens=None, compare_args=None):
+                 check_screens=None, compare_args=None, compact_key_handle: bool = False):
         # Refresh navigator screen content reference
         self.navigator._backend.get_current_screen_content()
 
         data = client_param + app_param
-        self.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+        p2 = U2F_P2.COMPACT_KEY_HANDLE if compact_key_handle else 0x00
+        self.send_apdu_nowait(ins=Ctap1.INS.REGISTER, p2=p2, data=data)
 
         instructions = []
 
@@ -160,7 +303,7 @@ class LedgerCtap1(Ctap1):
                 # Now that we have validate or abort the request with button
                 # press, we can resend the request and receive the "true"
                 # request response.
-                self.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+                self.send_apdu_nowait(ins=Ctap1.INS.REGISTER, p2=p2, data=data)
                 response = self.device.recv(CTAPHID.MSG)
                 response = self.parse_response(response)
             else:
@@ -254,3 +397,109 @@ class LedgerCtap1(Ctap1):
             self.wait_for_return_on_dashboard(dismiss=True)
 
         return SignatureData(response)
+
+    def send_chained_apdu(self, ins: int, data: bytes, chunk_size: int = APDU_MAX_DATA_SIZE,
+                          p1=0, p2=0):
+        """Send data in as many APDUs as needed, only the last one has a response"""
+        while len(data) > chunk_size:
+            response = self.send_apdu(cla=CLA_CHAINING, ins=ins, p1=p1, p2=p2,
+                                      data=data[:chunk_size])
+            assert response == b""
+            data = data[chunk_size:]
+
+        return self.send_apdu(ins=ins, p1=p1, p2=p2, data=data)
+
+    def check_key_handles(self, app_param: bytes, key_handles: list,
+                          chunk_size: int = APDU_MAX_DATA_SIZE):
+        data = app_param
+        for key_handle in key_handles:
+            data += struct.pack(">B", len(key_handle)) + key_handle
+
+        bitmap = self.send_chained_apdu(U2F_INS.CHECK_KEY_HANDLES, data, chunk_size)
+        assert len(bitmap) == (len(key_handles) + 7) // 8
+
+        return [bool(bitmap[i // 8] & (1 << (i % 8))) for i in range(len(key_handles))]
+
+    def build_known_apps_directory(self, apps: dict, version: int):
+        """Build the unsigned directory from a {rpIdHash: name} dict"""
+        names = b""
+        names_offset = {}
+        records = b""
+        for rp_id_hash, name in sorted(apps.items()):
+            if name not in names_offset:
+                names_offset[name] = len(names)
+                names += name.encode("ascii") + b"\0"
+            name_offset = struct.pack(">H", names_offset[name])
+            records += rp_id_hash[:KNOWN_APPS_PREFIX_SIZE] + name_offset
+        count = len(records) // KNOWN_APPS_RECORD_SIZE
+        return struct.pack(KNOWN_APPS_HEADER, version, count, len(names)) + records + names
+
+    def load_signed_known_apps(self, directory: bytes, signature: bytes,
+                               chunk_size: int = APDU_MAX_DATA_SIZE):
+        """Send the directory in chunks, in order, then its signature"""
+        header_size = struct.calcsize(KNOWN_APPS_HEADER)
+        _, count, _ = struct.unpack_from(KNOWN_APPS_HEADER, directory)
+        records = directory[header_size:header_size + count * KNOWN_APPS_RECORD_SIZE]
+        names = directory[header_size + len(records):]
+
+        self.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=LOAD_KNOWN_APPS_P1.BEGIN,
+                       data=directory[:header_size])
+
+        records_per_chunk = (chunk_size - 2) // KNOWN_APPS_RECORD_SIZE
+        for index in range(0, count, records_per_chunk):
+            offset = index * KNOWN_APPS_RECORD_SIZE
+            chunk = records[offset:offset + records_per_chunk * KNOWN_APPS_RECORD_SIZE]
+            self.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=LOAD_KNOWN_APPS_P1.RECORDS,
+                           data=struct.pack(">H", index) + chunk)
+
+        for offset in range(0, len(names), chunk_size - 2):
+            chunk = names[offset:offset + chunk_size - 2]
+            self.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=LOAD_KNOWN_APPS_P1.NAMES,
+                           data=struct.pack(">H", offset) + chunk)
+
+        self.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=LOAD_KNOWN_APPS_P1.COMMIT,
+                       data=signature)
+
+    def load_known_apps(self, apps: dict, version: int = None):
+        """Load apps, with a version newer than the loaded one by default"""
+        if version is None:
+            version = self.get_known_apps_info()[3] + 1
+        directory = self.build_known_apps_directory(apps, version)
+        self.load_signed_known_apps(directory, sign_known_apps_directory(directory))
+
+    def get_known_apps_info(self):
+        """Return the records count, the capacity and the version of the loaded directory"""
+        response = self.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=LOAD_KNOWN_APPS_P1.INFO)
+        return struct.unpack(">HHHI", response)
+
+    def get_stats(self):
+        return parse_stats(self.send_apdu(ins=U2F_INS.GET_STATS, p1=GET_STATS_P1.READ))
+
+    def reset_stats(self):
+        self.send_apdu(ins=U2F_INS.GET_STATS, p1=GET_STATS_P1.RESET)
+
+    def get_trace_pages(self):
+        pages = []
+        while True:
+            page = self.send_apdu(ins=U2F_INS.GET_TRACE, p1=len(pages), p2=GET_TRACE_P2.READ)
+            _, records = parse_trace_page(page)
+            if not records:
+                return pages
+            pages.append(page)
+
+    def clear_trace(self):
+        self.send_apdu(ins=U2F_INS.GET_TRACE, p2=GET_TRACE_P2.CLEAR)
+
+    def get_memory_usage(self):
+        return parse_memory_usage(self.send_apdu(ins=U2F_INS.GET_MEMORY_USAGE,
+                                                 p1=GET_MEMORY_USAGE_P1.READ))
+
+    def reset_memory_usage(self):
+        self.send_apdu(ins=U2F_INS.GET_MEMORY_USAGE, p1=GET_MEMORY_USAGE_P1.RESET)
+
+    def loopback_echo(self, data: bytes):
+        return self.send_apdu(ins=U2F_INS.LOOPBACK, p1=LOOPBACK_P1.ECHO, data=data)
+
+    def loopback_generate(self, length: int):
+        return self.send_apdu(ins=U2F_INS.LOOPBACK, p1=LOOPBACK_P1.GENERATE,
+                              data=struct.pack(">H", length))
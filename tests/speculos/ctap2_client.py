@@ -0,0 +1,95 @@
+from ledgered.devices import DeviceType
+
+from ragger.navigator import NavInsID
+
+from fido2.ctap import CtapDevice
+from fido2.ctap2 import Ctap2
+from fido2.hid import CAPABILITY, CTAPHID
+
+from ctap1_client import LedgerCtap1, U2F_INS
+
+
+class LedgerCtap2Device(CtapDevice):
+    """ CtapDevice sending CTAP2 requests as FIDO_INS_CTAP2_PROXY APDUs
+
+    The CBOR request and response are carried as is in the APDU data.
+    A navigation callback can be set to interact with the screen and
+    the buttons between the request and the response.
+    """
+    def __init__(self, ctap1: LedgerCtap1):
+        self.ctap1 = ctap1
+        self.navigation = None
+
+    @property
+    def capabilities(self):
+        return CAPABILITY.CBOR
+
+    def call(self, cmd, data=b"", event=None, on_keepalive=None):
+        if cmd != CTAPHID.CBOR:
+            raise ValueError("only CBOR command is supported")
+
+        self.ctap1.send_apdu_nowait(ins=U2F_INS.CTAP2_PROXY, data=data)
+        if self.navigation:
+            self.navigation()
+
+        response = self.ctap1.device.recv(CTAPHID.MSG)
+        return self.ctap1.parse_response(response)
+
+    def close(self):
+        pass
+
+    @classmethod
+    def list_devices(cls):
+        return iter([])
+
+
+class LedgerCtap2(Ctap2):
+    """ Overriding fido2.ctap2.Ctap2
+
+    make_credential() and get_assertion() are overridden to answer the
+    user presence request with the buttons, the same way LedgerCtap1 does.
+    Use user_accept=None when no user presence request is expected.
+    """
+    def __init__(self, ctap1: LedgerCtap1):
+        self.ctap1 = ctap1
+        super().__init__(LedgerCtap2Device(ctap1))
+
+    def answer_user_presence(self, user_accept: bool):
+        if self.ctap1.ledger_device.type == DeviceType.STAX:
+            if user_accept:
+                instructions = [NavInsID.USE_CASE_CHOICE_CONFIRM]
+            else:
+                instructions = [NavInsID.USE_CASE_CHOICE_REJECT]
+        elif user_accept:
+            instructions = [NavInsID.BOTH_CLICK]
+        else:
+            # The flow loops, abort screen is on the left of the first one
+            instructions = [NavInsID.LEFT_CLICK, NavInsID.BOTH_CLICK]
+
+        # Over U2F endpoint (but not over HID) the device needs the
+        # response to be retrieved before continuing the UX flow.
+        self.ctap1.navigator.navigate(instructions,
+                                      screen_change_after_last_instruction=False)
+
+    def _call_with_user_presence(self, func, user_accept):
+        if user_accept is not None:
+            # Refresh navigator screen content reference
+            self.ctap1.navigator._backend.get_current_screen_content()
+            self.device.navigation = lambda: self.answer_user_presence(user_accept)
+
+        try:
+            return func()
+        finally:
+            self.device.navigation = None
+            if user_accept is not None:
+                self.ctap1.wait_for_return_on_dashboard(dismiss=True)
+
+    def make_credential(self, *args, user_accept: bool = True, **kwargs):
+        return self._call_with_user_presence(
+            lambda: super(LedgerCtap2, self).make_credential(*args, **kwargs),
+            user_accept)
+
+    def get_assertion(self, *args, user_accept: bool = True, **kwargs):
+        return self._call_with_user_presence(
+            lambda: super(LedgerCtap2, self).get_assertion(*args, **kwargs),
+            user_accept)
@@ -0,0 +1,105 @@
+"""Decoder of the request timeline trace dumped with the GET_TRACE APDU.
+
+Ticks are counted by the app every 100 ms: records give the order of the
+events of a request, a phase shorter than a tick shows as +0.
+
+The app must be built with TRACE=1. Pages can be decoded offline:
+    python3 trace_decoder.py <page 0 hex> <page 1 hex> ...
+"""
+import struct
+import sys
+
+from collections import namedtuple
+
+TRACE_VERSION = 1
+TRACE_PAGE_HEADER = ">BBII"
+TRACE_RECORD = ">IBH"
+
+EVENTS = {
+    0x01: "apdu_received",
+    0x02: "length_parsed",
+    0x03: "unwrap_done",
+    0x04: "prompt_shown",
+    0x05: "user_decision",
+    0x06: "key_derived",
+    0x07: "signature_done",
+    0x08: "reply",
+}
+
+TraceRecord = namedtuple("TraceRecord", ["sequence", "tick", "event", "arg"])
+
+
+def parse_trace_page(data: bytes):
+    """Return the number of records added since the last clear, and the page records"""
+    version, count, total, first = struct.unpack_from(TRACE_PAGE_HEADER, data)
+    assert version == TRACE_VERSION
+    offset = struct.calcsize(TRACE_PAGE_HEADER)
+    record_size = struct.calcsize(TRACE_RECORD)
+    assert len(data) == offset + count * record_size
+
+    records = []
+    for i in range(count):
+        tick, event, arg = struct.unpack_from(TRACE_RECORD, data, offset)
+        offset += record_size
+        records.append(TraceRecord(first + i, tick, EVENTS.get(event, hex(event)), arg))
+
+    return total, records
+
+
+def split_requests(records):
+    """Group records per request, each starting with an apdu_received record.
+    Records of a request answered after user presence follow its prompt_shown
+    record, even if other requests were received in between."""
+    requests = []
+    current = None
+    pending = None
+    for record in records:
+        if record.event == "apdu_received":
+            current = {"ins": record.arg, "records": []}
+            requests.append(current)
+        elif record.event == "user_decision" and pending is not None:
+            current = pending
+        if current is None:
+            # Its start was overwritten
+            continue
+        current["records"].append(record)
+
+        if record.event == "prompt_shown":
+            pending = current
+        elif record.event == "reply" and current is pending:
+            pending = None
+
+    return requests
+
+
+def phase_breakdown(request):
+    """Ticks (100 ms) elapsed before each record of a request, named after the record"""
+    records = request["records"]
+    return [(current.event, current.tick - previous.tick)
+            for previous, current in zip(records, records[1:])]
+
+
+def format_breakdown(requests):
+    lines = []
+    for request in requests:
+        records = request["records"]
+        total = records[-1].tick - records[0].tick
+        lines.append("INS 0x{:02x}: {} ticks".format(request["ins"], total))
+        for event, ticks in phase_breakdown(request):
+            lines.append("    {:<16} +{}".format(event, ticks))
+    return "\n".join(lines)
+
+
+def decode_pages(pages):
+    records = []
+    for page in pages:
+        _, page_records = parse_trace_page(page)
+        if records and page_records and page_records[0].sequence != records[-1].sequence + 1:
+            print("Warning: records {} to {} were overwritten while dumping".format(
+                records[-1].sequence + 1, page_records[0].sequence - 1), file=sys.stderr)
+        records += page_records
+    return records
+
+
+if __name__ == "__main__":
+    print(format_breakdown(split_requests(decode_pages(bytes.fromhex(p) for p in sys.argv[1:]))))
@@ -1,8 +1,14 @@
 import cryptography
 import pytest
+import socket
 import struct
+import time
 from typing import Optional
 
+from ledgered.devices import DeviceType
+
+from ragger.navigator import NavInsID, NavIns
+
 from fido2.ctap1 import Ctap1, ApduError, SignatureData
 from fido2.hid import CTAPHID
 
@@ -80,6 +86,36 @@ def test_authenticate_check_only_wrong_app_param(client: TestClient):
     assert e.value.code == APDU.SW_WRONG_DATA
 
 
+def test_authenticate_check_only_then_sign(client: TestClient):
+    app_param, registration_data = register(client)
+    challenge = generate_random_bytes(32)
+
+    # Usual platform sequence: probe the key handle, then sign with it
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  app_param,
+                                  registration_data.key_handle,
+                                  check_only=True,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    # A probed key handle must still be refused for another app_param
+    wrong_app_param = bytearray(app_param)
+    wrong_app_param[0] ^= 0x40
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  wrong_app_param,
+                                  registration_data.key_handle,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+    authentication_data = client.ctap1.authenticate(challenge,
+                                                    app_param,
+                                                    registration_data.key_handle)
+
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+
 def test_authenticate_ok(client: TestClient, test_name: str):
     app_param, registration_data = register(client, FIDO_RP_ID_HASH_1)
     challenge = generate_random_bytes(32)
@@ -95,6 +131,20 @@ def test_authenticate_ok(client: TestClient, test_name: str):
     authentication_data.verify(app_param, challenge, registration_data.public_key)
 
 
+def test_authenticate_after_idle(client: TestClient):
+    # Leave the app idle long enough to fill its presignature pool, then use
+    # more signatures than the pool holds so that both paths are exercised.
+    time.sleep(3)
+    for _ in range(3):
+        app_param, registration_data = register(client)
+        challenge = generate_random_bytes(32)
+
+        authentication_data = client.ctap1.authenticate(challenge,
+                                                        app_param,
+                                                        registration_data.key_handle)
+        authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+
 def test_authenticate_user_refused(client: TestClient, test_name: str):
     app_param, registration_data = register(client, FIDO_RP_ID_HASH_1)
     challenge = generate_random_bytes(32)
@@ -162,6 +212,57 @@ def test_authenticate_counter_increment(client: TestClient):
         # doesn't keep NVM data.
 
 
+def test_authenticate_counter_increment_after_io_reset(client: TestClient):
+    # This test is specific for U2F endpoint, where a changed request
+    # received while waiting for user presence triggers an IO reset
+    if not client.use_U2F_endpoint:
+        pytest.skip("Does not work with this transport")
+
+    app_param, registration_data = register(client)
+    challenge = generate_random_bytes(32)
+
+    authentication_data = client.ctap1.authenticate(challenge,
+                                                    app_param,
+                                                    registration_data.key_handle)
+    prev = authentication_data.counter
+
+    challenge = bytearray(generate_random_bytes(32))
+    key_handle = registration_data.key_handle
+    data = challenge + app_param + struct.pack(">B", len(key_handle)) + key_handle
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                  p1=U2F_P1.REQUEST_USER_PRESENCE, data=data)
+    response = client.ctap1.device.recv(CTAPHID.MSG)
+    with pytest.raises(ApduError) as e:
+        client.ctap1.parse_response(response)
+    assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    client.ctap1.confirm()
+
+    # Change challenge first bit
+    challenge[0] ^= 0x40
+    data = challenge + app_param + struct.pack(">B", len(key_handle)) + key_handle
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                  p1=U2F_P1.REQUEST_USER_PRESENCE, data=data)
+    with pytest.raises(socket.timeout):
+        client.ctap1.device.recv(CTAPHID.MSG)
+
+    if client.device.type == DeviceType.STAX:
+        # Patch issue with click ignored on Speculos after a EXCEPTION_IO_RESET
+        client.navigator.navigate([NavIns(NavInsID.TAPPABLE_CENTER_TAP)],
+                                  screen_change_after_last_instruction=False)
+
+    client.ctap1.wait_for_return_on_dashboard()
+
+    # Counter values reserved before the IO reset are skipped
+    challenge = generate_random_bytes(32)
+    authentication_data = client.ctap1.authenticate(challenge,
+                                                    app_param,
+                                                    registration_data.key_handle)
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+    assert authentication_data.counter > prev
+
+
 def test_authenticate_no_registration(client: TestClient):
     challenge = generate_random_bytes(32)
 
@@ -347,3 +448,38 @@ def test_authenticate_raw(client: TestClient):
             authentication_data = SignatureData(response)
 
             authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+
+def test_authenticate_raw_replaced_by_other_request(client: TestClient):
+    if not client.use_U2F_endpoint:
+        pytest.skip("Does not work with this transport")
+
+    app_param, registration_data = register(client)
+    challenge = generate_random_bytes(32)
+    key_handle = registration_data.key_handle
+    data = challenge + app_param + struct.pack(">B", len(key_handle)) + key_handle
+
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                  p1=U2F_P1.REQUEST_USER_PRESENCE, data=data)
+    response = client.ctap1.device.recv(CTAPHID.MSG)
+    with pytest.raises(ApduError) as e:
+        client.ctap1.parse_response(response)
+    assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    # Another request takes over: the pending one is torn down and
+    # the device goes back to the dashboard without any user action
+    other_data = generate_random_bytes(32) + app_param + data[64:]
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.AUTHENTICATE,
+                                  p1=U2F_P1.REQUEST_USER_PRESENCE, data=other_data)
+    with pytest.raises(socket.timeout):
+        client.ctap1.device.recv(CTAPHID.MSG)
+
+    if client.device.type == DeviceType.STAX:
+        # Patch issue with click ignored on Speculos after a EXCEPTION_IO_RESET
+        client.navigator.navigate([NavIns(NavInsID.TAPPABLE_CENTER_TAP)],
+                                  screen_change_after_last_instruction=False)
+
+    client.ctap1.wait_for_return_on_dashboard()
+
+    authentication_data = client.ctap1.authenticate(challenge, app_param, key_handle)
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
@@ -0,0 +1,137 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from ctap1_client import APDU, CLA_CHAINING, U2F_INS
+from utils import generate_random_bytes
+
+
+def register(client: TestClient, app_param: bytes, compact_key_handle: bool = False):
+    challenge = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param,
+                                              compact_key_handle=compact_key_handle)
+    registration_data.verify(app_param, challenge)
+
+    return registration_data.key_handle
+
+
+def test_check_key_handles_ok(client: TestClient):
+    app_param = generate_random_bytes(32)
+    other_app_param = generate_random_bytes(32)
+
+    key_handle = register(client, app_param)
+    compact_key_handle = register(client, app_param, compact_key_handle=True)
+    other_key_handle = register(client, other_app_param)
+
+    key_handles = [
+        generate_random_bytes(65),
+        key_handle,
+        other_key_handle,
+        compact_key_handle,
+        generate_random_bytes(33),
+    ]
+    result = client.ctap1.check_key_handles(app_param, key_handles)
+    assert result == [False, True, False, True, False]
+
+    result = client.ctap1.check_key_handles(other_app_param, key_handles)
+    assert result == [False, False, True, False, False]
+
+
+def test_check_key_handles_bitmap(client: TestClient):
+    app_param = generate_random_bytes(32)
+    key_handle = register(client, app_param)
+
+    # Only the 10th key handle is valid, the response spans two bytes
+    key_handles = [generate_random_bytes(65) for _ in range(12)]
+    key_handles[9] = key_handle
+
+    bitmap = client.ctap1.send_apdu(ins=U2F_INS.CHECK_KEY_HANDLES,
+                                    data=app_param + b"".join(
+                                        bytes([len(x)]) + x for x in key_handles))
+    assert bitmap == bytes.fromhex("0002")
+
+
+def test_check_key_handles_empty_list(client: TestClient):
+    app_param = generate_random_bytes(32)
+
+    assert client.ctap1.check_key_handles(app_param, []) == []
+
+
+def test_check_key_handles_max_count(client: TestClient):
+    app_param = generate_random_bytes(32)
+    key_handle = register(client, app_param, compact_key_handle=True)
+
+    result = client.ctap1.check_key_handles(app_param, [key_handle] * 64)
+    assert result == [True] * 64
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.check_key_handles(app_param, [key_handle] * 65)
+    assert e.value.code == APDU.SW_WRONG_LENGTH
+
+
+def test_check_key_handles_wrong_length(client: TestClient):
+    app_param = generate_random_bytes(32)
+    key_handle = register(client, app_param)
+
+    # Application parameter too short
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.CHECK_KEY_HANDLES, data=app_param[:-1])
+    assert e.value.code == APDU.SW_WRONG_LENGTH
+
+    # Last key handle truncated
+    data = app_param + bytes([len(key_handle)]) + key_handle[:-1]
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.CHECK_KEY_HANDLES, data=data)
+    assert e.value.code == APDU.SW_WRONG_LENGTH
+
+
+def test_check_key_handles_wrong_p1p2(client: TestClient):
+    app_param = generate_random_bytes(32)
+
+    for p1, p2 in [(0x01, 0x00), (0x07, 0x00), (0x00, 0x01), (0xff, 0xff)]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.CHECK_KEY_HANDLES, p1=p1, p2=p2,
+                                   data=app_param)
+        assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+
+def test_check_key_handles_chained(client: TestClient):
+    app_param = generate_random_bytes(32)
+    key_handle = register(client, app_param)
+
+    # 64 full size key handles don't fit in a single APDU
+    key_handles = [generate_random_bytes(len(key_handle)) for _ in range(64)]
+    key_handles[40] = key_handle
+    expected = [i == 40 for i in range(64)]
+
+    result = client.ctap1.check_key_handles(app_param, key_handles)
+    assert result == expected
+
+    # Chunks splitting the application parameter and key handles anywhere
+    result = client.ctap1.check_key_handles(app_param, key_handles[:12], chunk_size=7)
+    assert result == expected[:12]
+
+
+def test_check_key_handles_chained_max_count(client: TestClient):
+    app_param = generate_random_bytes(32)
+    key_handle = register(client, app_param)
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.check_key_handles(app_param, [key_handle] * 65)
+    assert e.value.code == APDU.SW_WRONG_LENGTH
+
+
+def test_check_key_handles_chained_aborted(client: TestClient):
+    app_param = generate_random_bytes(32)
+
+    client.ctap1.send_apdu(cla=CLA_CHAINING, ins=U2F_INS.CHECK_KEY_HANDLES,
+                           data=app_param)
+
+    # Another command aborts the chained request
+    client.ctap1.get_version()
+
+    # So this is the start of a new request, with a truncated application parameter
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.CHECK_KEY_HANDLES, data=bytes(10))
+    assert e.value.code == APDU.SW_WRONG_LENGTH
@@ -3,13 +3,14 @@ import struct
 
 from fido2.ctap1 import Ctap1, ApduError
 
-from ctap1_client import APDU
+from ctap1_client import APDU, U2F_INS
 from client import TestClient
 from utils import generate_random_bytes
 
 
 def test_cmd_wrong_cla(client: TestClient):
-    # Only supported CLA is 0x00
+    # Only supported CLA is 0x00, 0x10 (chaining) only being supported by
+    # commands streaming their data
     for cla in range(1, 0xff + 1):
         with pytest.raises(ApduError) as e:
             client.ctap1.send_apdu(cla=cla,
@@ -20,10 +21,24 @@ def test_cmd_wrong_cla(client: TestClient):
         assert e.value.code == APDU.SW_CLA_NOT_SUPPORTED
 
 
-def test_cmd_wrong_ins(client: TestClient):
+# Proprietary INS and the feature compiling them in
+OPTIONAL_INS = {
+    U2F_INS.LOAD_KNOWN_APPS: "known_apps_nvm",
+    U2F_INS.GET_STATS: "stats",
+    U2F_INS.GET_TRACE: "trace",
+    U2F_INS.GET_MEMORY_USAGE: "memory_usage",
+    U2F_INS.LOOPBACK: "loopback",
+}
+
+
+def test_cmd_wrong_ins(client: TestClient, features: set):
+    # Always supported INS are [0x01, 0x02, 0x03, 0x10, 0x40], the others only
+    # when their feature is compiled in
+    supported_ins = [0x01, 0x02, 0x03, 0x10, 0x40]
+    supported_ins += [ins for ins, feature in OPTIONAL_INS.items() if feature in features]
+
     for ins in range(0xff + 1):
-        # Only supported INS are [0x01, 0x02, 0x03, 0x10]
-        if ins in [0x01, 0x02, 0x03, 0x10]:
+        if ins in supported_ins:
             continue
 
         with pytest.raises(ApduError) as e:
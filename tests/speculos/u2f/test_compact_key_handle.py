@@ -0,0 +1,83 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from ctap1_client import APDU
+from utils import generate_random_bytes
+
+COMPACT_KEY_HANDLE_SIZE = 33
+
+
+def register_compact(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+
+    registration_data = client.ctap1.register(challenge, app_param,
+                                              compact_key_handle=True)
+    registration_data.verify(app_param, challenge)
+
+    return app_param, registration_data
+
+
+def test_register_compact_ok(client: TestClient):
+    _, registration_data = register_compact(client)
+
+    assert len(registration_data.key_handle) == COMPACT_KEY_HANDLE_SIZE
+    assert registration_data.key_handle[0] == 0x03
+
+
+def test_authenticate_compact_ok(client: TestClient):
+    app_param, registration_data = register_compact(client)
+    challenge = generate_random_bytes(32)
+
+    authentication_data = client.ctap1.authenticate(challenge,
+                                                    app_param,
+                                                    registration_data.key_handle)
+
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+
+def test_authenticate_compact_check_only(client: TestClient):
+    app_param, registration_data = register_compact(client)
+    challenge = generate_random_bytes(32)
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  app_param,
+                                  registration_data.key_handle,
+                                  check_only=True,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+
+def test_authenticate_compact_wrong_key_handle(client: TestClient):
+    app_param, registration_data = register_compact(client)
+    challenge = generate_random_bytes(32)
+
+    # Change the last bit of the truncated signature, then of the nonce
+    for offset in [-1, 1]:
+        key_handle = bytearray(registration_data.key_handle)
+        key_handle[offset] ^= 0x01
+
+        with pytest.raises(ApduError) as e:
+            client.ctap1.authenticate(challenge,
+                                      app_param,
+                                      key_handle,
+                                      user_accept=None)
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+
+def test_authenticate_compact_wrong_app_param(client: TestClient):
+    app_param, registration_data = register_compact(client)
+    challenge = generate_random_bytes(32)
+
+    app_param = bytearray(app_param)
+    app_param[0] ^= 0x40
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  app_param,
+                                  registration_data.key_handle,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_WRONG_DATA
@@ -0,0 +1,217 @@
+import pytest
+
+from fido2.cose import ES256
+from fido2.ctap import CtapError
+from fido2.ctap1 import ApduError
+from fido2.webauthn import AttestationObject, AuthenticatorData
+
+from client import TestClient, LedgerAttestationVerifier
+from ctap1_client import APDU, APDU_MAX_DATA_SIZE, U2F_INS
+from ctap2_client import LedgerCtap2
+from utils import generate_random_bytes, get_rp_id_hash
+
+RP_ID = "example.com"
+USER = {"id": b"user_id", "name": "user"}
+ES256_PARAMS = [{"type": "public-key", "alg": ES256.ALGORITHM}]
+
+
+@pytest.fixture
+def ctap2(client: TestClient):
+    return LedgerCtap2(client.ctap1)
+
+
+def make_credential(ctap2: LedgerCtap2, client_data_hash: bytes = None):
+    if client_data_hash is None:
+        client_data_hash = generate_random_bytes(32)
+
+    response = ctap2.make_credential(client_data_hash, {"id": RP_ID}, USER, ES256_PARAMS)
+    return response.auth_data.credential_data
+
+
+def descriptor(credential_id: bytes):
+    return {"type": "public-key", "id": credential_id}
+
+
+def test_ctap2_get_info(ctap2: LedgerCtap2):
+    info = ctap2.info
+    assert info.versions == ["U2F_V2", "FIDO_2_0"]
+    # Required by the fido-u2f attestation format
+    assert info.aaguid == bytes(16)
+    assert info.options == {"rk": False, "up": True, "plat": False}
+    assert info.max_msg_size == APDU_MAX_DATA_SIZE
+    assert info.algorithms == ES256_PARAMS
+
+
+def test_ctap2_make_credential_ok(ctap2: LedgerCtap2):
+    client_data_hash = generate_random_bytes(32)
+
+    response = ctap2.make_credential(client_data_hash, {"id": RP_ID}, USER, ES256_PARAMS)
+
+    assert response.fmt == "fido-u2f"
+    auth_data = response.auth_data
+    assert auth_data.rp_id_hash == get_rp_id_hash(RP_ID)
+    assert auth_data.flags == AuthenticatorData.FLAG.UP | AuthenticatorData.FLAG.AT
+    assert auth_data.credential_data.aaguid == bytes(16)
+    assert auth_data.credential_data.public_key.ALGORITHM == ES256.ALGORITHM
+
+    attestation = AttestationObject.create(response.fmt, auth_data, response.att_stmt)
+    LedgerAttestationVerifier().verify_attestation(attestation, client_data_hash)
+
+
+def test_ctap2_make_credential_user_refused(ctap2: LedgerCtap2):
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              ES256_PARAMS, user_accept=False)
+    assert e.value.code == CtapError.ERR.OPERATION_DENIED
+
+
+def test_ctap2_make_credential_excluded(ctap2: LedgerCtap2):
+    credential_data = make_credential(ctap2)
+
+    exclude_list = [descriptor(generate_random_bytes(65)),
+                    descriptor(credential_data.credential_id)]
+    # Only reported once the user presence is confirmed
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              ES256_PARAMS, exclude_list=exclude_list)
+    assert e.value.code == CtapError.ERR.CREDENTIAL_EXCLUDED
+
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              ES256_PARAMS, exclude_list=exclude_list, user_accept=False)
+    assert e.value.code == CtapError.ERR.OPERATION_DENIED
+
+    # Credential of another RP is not excluded
+    response = ctap2.make_credential(generate_random_bytes(32), {"id": "other.com"}, USER,
+                                     ES256_PARAMS, exclude_list=exclude_list)
+    assert response.auth_data.is_attested()
+
+
+def test_ctap2_make_credential_unsupported(ctap2: LedgerCtap2):
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              [{"type": "public-key", "alg": -8}], user_accept=None)
+    assert e.value.code == CtapError.ERR.UNSUPPORTED_ALGORITHM
+
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              ES256_PARAMS, options={"rk": True}, user_accept=None)
+    assert e.value.code == CtapError.ERR.UNSUPPORTED_OPTION
+
+    with pytest.raises(CtapError) as e:
+        ctap2.make_credential(generate_random_bytes(32), {"id": RP_ID}, USER,
+                              ES256_PARAMS, options={"uv": True}, user_accept=None)
+    assert e.value.code == CtapError.ERR.UNSUPPORTED_OPTION
+
+
+def test_ctap2_get_assertion_ok(ctap2: LedgerCtap2):
+    credential_data = make_credential(ctap2)
+    client_data_hash = generate_random_bytes(32)
+
+    # The whole allow list is evaluated in a single request
+    allow_list = [descriptor(generate_random_bytes(65)) for _ in range(8)]
+    allow_list.insert(5, descriptor(credential_data.credential_id))
+
+    response = ctap2.get_assertion(RP_ID, client_data_hash, allow_list)
+
+    assert response.credential["id"] == credential_data.credential_id
+    assert response.auth_data.rp_id_hash == get_rp_id_hash(RP_ID)
+    assert response.auth_data.flags == AuthenticatorData.FLAG.UP
+    response.verify(client_data_hash, credential_data.public_key)
+
+    # Counter is shared and increasing
+    counter = response.auth_data.counter
+    response = ctap2.get_assertion(RP_ID, client_data_hash, allow_list)
+    assert response.auth_data.counter > counter
+
+
+def test_ctap2_get_assertion_user_refused(ctap2: LedgerCtap2):
+    credential_data = make_credential(ctap2)
+
+    with pytest.raises(CtapError) as e:
+        ctap2.get_assertion(RP_ID, generate_random_bytes(32),
+                            [descriptor(credential_data.credential_id)], user_accept=False)
+    assert e.value.code == CtapError.ERR.OPERATION_DENIED
+
+
+def test_ctap2_get_assertion_silent(ctap2: LedgerCtap2):
+    credential_data = make_credential(ctap2)
+    client_data_hash = generate_random_bytes(32)
+
+    response = ctap2.get_assertion(RP_ID, client_data_hash,
+                                   [descriptor(credential_data.credential_id)],
+                                   options={"up": False}, user_accept=None)
+
+    assert not response.auth_data.is_user_present()
+    response.verify(client_data_hash, credential_data.public_key)
+
+
+def test_ctap2_get_assertion_u2f_credential(client: TestClient, ctap2: LedgerCtap2):
+    # Key handles registered over U2F are valid CTAP2 credentials
+    for compact_key_handle in [False, True]:
+        registration_data = client.ctap1.register(generate_random_bytes(32),
+                                                  get_rp_id_hash(RP_ID),
+                                                  compact_key_handle=compact_key_handle)
+        client_data_hash = generate_random_bytes(32)
+
+        response = ctap2.get_assertion(RP_ID, client_data_hash,
+                                       [descriptor(registration_data.key_handle)])
+
+        assert response.credential["id"] == registration_data.key_handle
+        response.verify(client_data_hash, ES256.from_ctap1(registration_data.public_key))
+
+
+def test_ctap2_get_assertion_no_credentials(ctap2: LedgerCtap2):
+    credential_data = make_credential(ctap2)
+
+    # Unknown credentials only
+    allow_list = [descriptor(generate_random_bytes(65)) for _ in range(4)]
+    with pytest.raises(CtapError) as e:
+        ctap2.get_assertion(RP_ID, generate_random_bytes(32), allow_list, user_accept=None)
+    assert e.value.code == CtapError.ERR.NO_CREDENTIALS
+
+    # Credential of another RP
+    with pytest.raises(CtapError) as e:
+        ctap2.get_assertion("other.com", generate_random_bytes(32),
+                            [descriptor(credential_data.credential_id)], user_accept=None)
+    assert e.value.code == CtapError.ERR.NO_CREDENTIALS
+
+    # Resident credentials are not supported
+    with pytest.raises(CtapError) as e:
+        ctap2.get_assertion(RP_ID, generate_random_bytes(32), user_accept=None)
+    assert e.value.code == CtapError.ERR.NO_CREDENTIALS
+
+
+def test_ctap2_get_assertion_too_many_credentials(client: TestClient):
+    # A 65 entries allow list doesn't fit in a message, the count is checked
+    # before the entries are read
+    rp_id = RP_ID.encode()
+    data = b"\x02\xa3"
+    data += b"\x01" + bytes([0x60 + len(rp_id)]) + rp_id
+    data += b"\x02\x58\x20" + generate_random_bytes(32)
+    data += b"\x03\x98\x41"
+    response = client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, data=data)
+    assert response == bytes([CtapError.ERR.LIMIT_EXCEEDED])
+
+
+def test_ctap2_raw_errors(client: TestClient):
+    # Unknown command
+    response = client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, data=b"\x05")
+    assert response == bytes([CtapError.ERR.INVALID_COMMAND])
+
+    # Truncated CBOR
+    response = client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, data=b"\x01\xa1")
+    assert response == bytes([CtapError.ERR.INVALID_CBOR])
+
+    # Missing command
+    response = client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, data=b"")
+    assert response == bytes([CtapError.ERR.INVALID_LENGTH])
+
+    # Missing parameters
+    response = client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, data=b"\x02\xa0")
+    assert response == bytes([CtapError.ERR.MISSING_PARAMETER])
+
+    for p1, p2 in [(0x01, 0x00), (0x00, 0x01)]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.CTAP2_PROXY, p1=p1, p2=p2, data=b"\x04")
+        assert e.value.code == APDU.SW_INCORRECT_P1P2
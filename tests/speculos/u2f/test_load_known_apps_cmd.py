@@ -0,0 +1,255 @@
+import pytest
+import struct
+
+from fido2.ctap1 import ApduError, Ctap1
+from fido2.hid import CTAPHID
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU, KNOWN_APPS_HEADER, KNOWN_APPS_PREFIX_SIZE, LOAD_KNOWN_APPS_P1, \
+    U2F_INS, sign_known_apps_directory
+from utils import fido_known_appid, generate_random_bytes, get_rp_id_hash
+
+
+def register_and_check_name(client: TestClient, app_param: bytes, name: str):
+    challenge = generate_random_bytes(32)
+    data = challenge + app_param
+
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+    client.backend.wait_for_text_on_screen(name)
+    client.ctap1.confirm()
+
+    response = client.ctap1.device.recv(CTAPHID.MSG)
+    try:
+        client.ctap1.parse_response(response)
+    except ApduError as e:
+        # Over U2F endpoint, the request must be resent once the user confirmed
+        assert e.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+        client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+        client.ctap1.parse_response(client.ctap1.device.recv(CTAPHID.MSG))
+    client.ctap1.wait_for_return_on_dashboard(dismiss=True)
+
+
+def load_raw(client: TestClient, directory: bytes):
+    client.ctap1.load_signed_known_apps(directory, sign_known_apps_directory(directory))
+
+
+def header(client: TestClient, count: int, names_size: int):
+    version = client.ctap1.get_known_apps_info()[3] + 1
+    return struct.pack(KNOWN_APPS_HEADER, version, count, names_size)
+
+
+def send_load_apdu(client: TestClient, p1: int, data: bytes):
+    return client.ctap1.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=p1, data=data)
+
+
+def record(rp_id: str, name_offset: int):
+    return get_rp_id_hash(rp_id)[:KNOWN_APPS_PREFIX_SIZE] + struct.pack(">H", name_offset)
+
+
+@pytest.fixture(autouse=True)
+def clear_directory(client: TestClient, features: set):
+    require_feature(features, "known_apps_nvm")
+
+    # NVM is kept between tests, don't leak a directory to other tests
+    yield
+    client.ctap1.load_known_apps({})
+
+
+def test_load_known_apps_info(client: TestClient):
+    _, max_count, max_names_size, _ = client.ctap1.get_known_apps_info()
+    assert max_count >= 256
+    assert max_names_size >= 2048
+
+
+def test_load_known_apps_ok(client: TestClient):
+    # Records and names span several chunks
+    _, max_count, _, _ = client.ctap1.get_known_apps_info()
+    apps = {get_rp_id_hash("internal-{}.example.com".format(i)): "Internal {}".format(i % 7)
+            for i in range(max_count)}
+    client.ctap1.load_known_apps(apps)
+
+    count, _, _, _ = client.ctap1.get_known_apps_info()
+    assert count == len(apps)
+
+    register_and_check_name(client, get_rp_id_hash("internal-21.example.com"), "Internal 0")
+
+
+def test_load_known_apps_small_chunks(client: TestClient):
+    apps = {get_rp_id_hash("internal-{}.example.com".format(i)): "Internal app {}".format(i)
+            for i in range(20)}
+    version = client.ctap1.get_known_apps_info()[3] + 1
+    directory = client.ctap1.build_known_apps_directory(apps, version)
+    client.ctap1.load_signed_known_apps(directory, sign_known_apps_directory(directory),
+                                        chunk_size=32)
+
+    assert client.ctap1.get_known_apps_info()[0] == len(apps)
+    register_and_check_name(client, get_rp_id_hash("internal-7.example.com"), "Internal app 7")
+
+
+def test_load_known_apps_builtin_first(client: TestClient):
+    # A loaded directory can't rename a built-in app
+    builtin_app_param, builtin_name = list(fido_known_appid.items())[0]
+    client.ctap1.load_known_apps({builtin_app_param: "Not " + builtin_name})
+
+    register_and_check_name(client, builtin_app_param, builtin_name)
+
+
+def test_load_known_apps_replace(client: TestClient):
+    client.ctap1.load_known_apps({get_rp_id_hash("a.example.com"): "A",
+                                  get_rp_id_hash("b.example.com"): "B"})
+    assert client.ctap1.get_known_apps_info()[0] == 2
+
+    # The same directory with a newer version is accepted
+    client.ctap1.load_known_apps({get_rp_id_hash("a.example.com"): "A",
+                                  get_rp_id_hash("b.example.com"): "B"})
+    assert client.ctap1.get_known_apps_info()[0] == 2
+
+    client.ctap1.load_known_apps({get_rp_id_hash("c.example.com"): "C"})
+    assert client.ctap1.get_known_apps_info()[0] == 1
+
+    # An empty directory clears it
+    client.ctap1.load_known_apps({})
+    assert client.ctap1.get_known_apps_info()[0] == 0
+
+
+def test_load_known_apps_replay(client: TestClient):
+    version = client.ctap1.get_known_apps_info()[3] + 1
+    old = client.ctap1.build_known_apps_directory({get_rp_id_hash("a.example.com"): "A"},
+                                                  version)
+    old_signature = sign_known_apps_directory(old)
+    client.ctap1.load_signed_known_apps(old, old_signature)
+    client.ctap1.load_known_apps({get_rp_id_hash("b.example.com"): "B"}, version + 1)
+    assert client.ctap1.get_known_apps_info()[3] == version + 1
+
+    # An older directory, or another one with the same version, is refused from the start
+    same_version = client.ctap1.build_known_apps_directory({get_rp_id_hash("c.example.com"): "C"},
+                                                           version + 1)
+    for directory, signature in [(old, old_signature),
+                                 (same_version, sign_known_apps_directory(same_version))]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.load_signed_known_apps(directory, signature)
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+    # The loaded directory is kept
+    assert client.ctap1.get_known_apps_info()[0] == 1
+    register_and_check_name(client, get_rp_id_hash("b.example.com"), "B")
+
+
+def test_load_known_apps_wrong_signature(client: TestClient):
+    client.ctap1.load_known_apps({get_rp_id_hash("a.example.com"): "A"})
+    version = client.ctap1.get_known_apps_info()[3]
+    directory = client.ctap1.build_known_apps_directory({get_rp_id_hash("b.example.com"): "B"},
+                                                        version + 1)
+
+    # Signed with another key, signing another directory, or not a signature
+    other_key = int.from_bytes(generate_random_bytes(31), "big")
+    other_directory = directory[:-2] + b"C\0"
+    for signature in [sign_known_apps_directory(directory, other_key),
+                      sign_known_apps_directory(other_directory),
+                      b"",
+                      generate_random_bytes(72)]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.load_signed_known_apps(directory, signature)
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+    # The chunks were written: the directory is left disabled, with its version
+    assert client.ctap1.get_known_apps_info()[0] == 0
+    assert client.ctap1.get_known_apps_info()[3] == version
+
+
+def test_load_known_apps_unsorted(client: TestClient):
+    records = [record("a.example.com", 0), record("b.example.com", 2)]
+    records.sort(reverse=True)
+    directory = header(client, 2, 4) + b"".join(records) + b"A\0B\0"
+
+    with pytest.raises(ApduError) as e:
+        load_raw(client, directory)
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+    assert client.ctap1.get_known_apps_info()[0] == 0
+
+
+def test_load_known_apps_wrong_name(client: TestClient):
+    directories = [
+        # Offset past the names area
+        (1, 2, record("a.example.com", 2) + b"A\0"),
+        # Offset in the middle of a name
+        (1, 3, record("a.example.com", 1) + b"AB\0"),
+        # Names not terminated
+        (1, 2, record("a.example.com", 0) + b"AB"),
+        # Non printable names
+        (1, 3, record("a.example.com", 0) + b"A\n\0"),
+        (1, 3, record("a.example.com", 0) + "\u00e9".encode("utf8") + b"\0"),
+        # Records without names
+        (1, 0, record("a.example.com", 0)),
+    ]
+    for count, names_size, data in directories:
+        with pytest.raises(ApduError) as e:
+            load_raw(client, header(client, count, names_size) + data)
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+    assert client.ctap1.get_known_apps_info()[0] == 0
+
+
+def test_load_known_apps_out_of_bounds(client: TestClient):
+    _, max_count, max_names_size, _ = client.ctap1.get_known_apps_info()
+
+    for count, names_size in [(max_count + 1, 2), (1, max_names_size + 1)]:
+        with pytest.raises(ApduError) as e:
+            send_load_apdu(client, LOAD_KNOWN_APPS_P1.BEGIN, header(client, count, names_size))
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+    with pytest.raises(ApduError) as e:
+        send_load_apdu(client, LOAD_KNOWN_APPS_P1.BEGIN, header(client, 1, 2)[:-1])
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+    # More data than announced
+    for p1, data in [(LOAD_KNOWN_APPS_P1.RECORDS, b"\x00\x00" + record("a.example.com", 0) * 2),
+                     (LOAD_KNOWN_APPS_P1.NAMES, b"\x00\x00" + b"AB\0")]:
+        send_load_apdu(client, LOAD_KNOWN_APPS_P1.BEGIN, header(client, 1, 2))
+        if p1 == LOAD_KNOWN_APPS_P1.NAMES:
+            send_load_apdu(client, LOAD_KNOWN_APPS_P1.RECORDS,
+                           b"\x00\x00" + record("a.example.com", 0))
+        with pytest.raises(ApduError) as e:
+            send_load_apdu(client, p1, data)
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+
+def test_load_known_apps_wrong_sequence(client: TestClient):
+    directory = header(client, 2, 4) + record("a.example.com", 0) + record("b.example.com", 2)
+    signature = sign_known_apps_directory(directory + b"A\0B\0")
+    sequences = [
+        # No BEGIN
+        [(LOAD_KNOWN_APPS_P1.RECORDS, b"\x00\x00" + directory[8:])],
+        # Records out of order
+        [(LOAD_KNOWN_APPS_P1.BEGIN, directory[:8]),
+         (LOAD_KNOWN_APPS_P1.RECORDS, b"\x00\x01" + directory[18:])],
+        # Names before the records
+        [(LOAD_KNOWN_APPS_P1.BEGIN, directory[:8]),
+         (LOAD_KNOWN_APPS_P1.NAMES, b"\x00\x00" + b"A\0B\0")],
+        # Names out of order
+        [(LOAD_KNOWN_APPS_P1.BEGIN, directory[:8]),
+         (LOAD_KNOWN_APPS_P1.RECORDS, b"\x00\x00" + directory[8:]),
+         (LOAD_KNOWN_APPS_P1.NAMES, b"\x00\x02" + b"B\0")],
+        # COMMIT before all the names
+        [(LOAD_KNOWN_APPS_P1.BEGIN, directory[:8]),
+         (LOAD_KNOWN_APPS_P1.RECORDS, b"\x00\x00" + directory[8:]),
+         (LOAD_KNOWN_APPS_P1.NAMES, b"\x00\x00" + b"A\0"),
+         (LOAD_KNOWN_APPS_P1.COMMIT, signature)],
+    ]
+    for sequence in sequences:
+        for p1, data in sequence[:-1]:
+            send_load_apdu(client, p1, data)
+        with pytest.raises(ApduError) as e:
+            send_load_apdu(client, *sequence[-1])
+        assert e.value.code == APDU.SW_WRONG_DATA
+
+    assert client.ctap1.get_known_apps_info()[0] == 0
+
+
+def test_load_known_apps_wrong_p1p2(client: TestClient):
+    for p1, p2 in [(0x05, 0x00), (0xff, 0x00), (LOAD_KNOWN_APPS_P1.INFO, 0x01)]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.LOAD_KNOWN_APPS, p1=p1, p2=p2)
+        assert e.value.code == APDU.SW_INCORRECT_P1P2
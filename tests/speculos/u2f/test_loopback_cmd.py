@@ -0,0 +1,47 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU, APDU_BUFFER_SIZE, APDU_MAX_DATA_SIZE, LOOPBACK_P1, U2F_INS
+from utils import generate_random_bytes
+
+# Largest response data, the status word being appended in the APDU buffer
+GENERATE_MAX_SIZE = APDU_BUFFER_SIZE - 2
+
+
+@pytest.fixture(autouse=True)
+def loopback_supported(client: TestClient, features: set):
+    require_feature(features, "loopback")
+
+
+@pytest.mark.parametrize("size", [0, 1, 57, 58, 256, APDU_MAX_DATA_SIZE])
+def test_loopback_echo(client: TestClient, size: int):
+    data = generate_random_bytes(size)
+    assert client.ctap1.loopback_echo(data) == data
+
+
+@pytest.mark.parametrize("size", [0, 1, 57, 58, 256, GENERATE_MAX_SIZE])
+def test_loopback_generate(client: TestClient, size: int):
+    assert client.ctap1.loopback_generate(size) == bytes(i % 256 for i in range(size))
+
+
+def test_loopback_generate_too_long(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.loopback_generate(GENERATE_MAX_SIZE + 1)
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+
+def test_loopback_generate_wrong_length(client: TestClient):
+    for data in [b"", b"\x00", b"\x00\x00\x00"]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.LOOPBACK, p1=LOOPBACK_P1.GENERATE, data=data)
+        assert e.value.code == APDU.SW_WRONG_LENGTH
+
+
+def test_loopback_wrong_p1p2(client: TestClient):
+    for p1, p2 in [(0x02, 0x00), (0xff, 0x00), (0x00, 0x01), (0x01, 0xff)]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.LOOPBACK, p1=p1, p2=p2, data=b"\x00\x00")
+        assert e.value.code == APDU.SW_INCORRECT_P1P2
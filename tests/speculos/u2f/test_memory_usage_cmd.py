@@ -0,0 +1,77 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU, U2F_INS
+from utils import generate_random_bytes
+
+# Stack which must be left unused by each command class
+STACK_MIN_FREE = 256
+
+# Budgets of the main static buffers, raise them deliberately
+STATIC_BUDGETS = {
+    "shared_ctx": 1000,
+    "scratch": 400,
+    "verify_hash": 65,
+    "verify_name": 65,
+}
+
+
+@pytest.fixture(autouse=True)
+def memory_usage_supported(client: TestClient, features: set):
+    require_feature(features, "memory_usage")
+    client.ctap1.reset_memory_usage()
+
+
+def test_memory_usage_stack(client: TestClient):
+    client.ctap1.send_apdu(ins=0x03)
+
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    authentication_data = client.ctap1.authenticate(challenge, app_param,
+                                                    registration_data.key_handle)
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+    usage = client.ctap1.get_memory_usage()
+    print("Stack size", usage["stack_size"])
+    for name, used in usage["stack_used"].items():
+        print("Stack used by", name, used)
+        assert used is not None
+        assert used <= usage["stack_size"] - STACK_MIN_FREE
+
+
+def test_memory_usage_static(client: TestClient):
+    usage = client.ctap1.get_memory_usage()
+    for name, size in usage["static"].items():
+        print("Size of", name, size)
+
+    for name, budget in STATIC_BUDGETS.items():
+        assert usage["static"][name] <= budget
+    assert usage["static"]["u2f_data"] + usage["static"]["credential_cache"] \
+        + usage["static"]["scratch"] <= usage["static"]["shared_ctx"]
+
+
+def test_memory_usage_reset(client: TestClient):
+    usage = client.ctap1.get_memory_usage()
+    assert usage["stack_used"]["enroll"] is None
+    assert usage["stack_used"]["sign"] is None
+    assert usage["stack_used"]["other"] is not None
+
+
+def test_memory_usage_wrong_p1p2(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_MEMORY_USAGE, p1=0x02)
+    assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_MEMORY_USAGE, p2=0x01)
+    assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+
+def test_memory_usage_wrong_length(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_MEMORY_USAGE, data=b"\x00")
+    assert e.value.code == APDU.SW_WRONG_LENGTH
@@ -1,7 +1,10 @@
+import os
 import pytest
 import socket
+import time
 
 from cryptography.x509 import load_der_x509_certificate
+from cryptography.x509.oid import NameOID
 
 from ledgered.devices import DeviceType
 
@@ -14,9 +17,12 @@ from fido2.hid import CTAPHID
 from fido2.webauthn import AttestationObject
 
 from client import TESTS_SPECULOS_DIR, TestClient, LedgerAttestationVerifier
-from ctap1_client import APDU, U2F_P1
+from ctap1_client import APDU, U2F_P1, U2F_P2
 from utils import FIDO_RP_ID_HASH_1, generate_random_bytes
 
+# Delay after which a pending request is cancelled, see U2F_USER_PRESENCE_TIMEOUT_S
+USER_PRESENCE_TIMEOUT = 30
+
 
 def test_register_ok(client: TestClient, test_name: str):
     challenge = generate_random_bytes(32)
@@ -53,6 +59,49 @@ def test_register_certificate(client: TestClient):
     assert cert.extensions[0].value.value == bytes.fromhex("03020520")
 
 
+def test_register_certificate_compact(client: TestClient):
+    if os.environ.get("USE_PROD_CA", False):
+        pytest.skip("Only test certificates use the compact profile")
+
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+
+    registration_data = client.ctap1.register(challenge, app_param)
+
+    # The certificate must still be accepted by the fido2 library
+    verifier = LedgerAttestationVerifier()
+    attestation = AttestationObject.from_ctap1(app_param, registration_data)
+    verifier.verify_attestation(attestation, challenge)
+
+    # Compact profile: the subject only holds a short CN
+    cert = load_der_x509_certificate(registration_data.certificate)
+    assert len(cert.subject) == 1
+    assert len(cert.subject.get_attributes_for_oid(NameOID.COMMON_NAME)) == 1
+    assert len(registration_data.certificate) <= 440
+
+
+def test_register_response_layout(client: TestClient):
+    # The response is assembled from parts computed at different times,
+    # it must still be the exact concatenation expected by the U2F spec
+    certificates = set()
+    for compact_key_handle in [False, True]:
+        challenge = generate_random_bytes(32)
+        app_param = generate_random_bytes(32)
+
+        registration_data = client.ctap1.register(challenge, app_param,
+                                                  compact_key_handle=compact_key_handle)
+        registration_data.verify(app_param, challenge)
+
+        key_handle = registration_data.key_handle
+        expected = b"\x05" + registration_data.public_key
+        expected += bytes([len(key_handle)]) + key_handle
+        expected += registration_data.certificate + registration_data.signature
+        assert bytes(registration_data) == expected
+        certificates.add(registration_data.certificate)
+
+    assert len(certificates) == 1
+
+
 def test_register_user_refused(client: TestClient, test_name: str):
     challenge = generate_random_bytes(32)
     app_param = FIDO_RP_ID_HASH_1
@@ -185,6 +234,37 @@ def test_register_raw(client: TestClient):
     registration_data.verify(app_param, challenge)
 
 
+def test_register_raw_timeout(client: TestClient):
+    if not client.use_U2F_endpoint:
+        pytest.skip("Does not work with this transport")
+
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    data = challenge + app_param
+
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+    response = client.ctap1.device.recv(CTAPHID.MSG)
+    with pytest.raises(ApduError) as e:
+        client.ctap1.parse_response(response)
+    assert e.value.code == APDU.SW_CONDITIONS_NOT_SATISFIED
+
+    # Nobody answers the prompt, the request is cancelled
+    time.sleep(USER_PRESENCE_TIMEOUT + 1)
+    client.ctap1.wait_for_return_on_dashboard()
+
+    client.ctap1.send_apdu_nowait(ins=Ctap1.INS.REGISTER, data=data)
+    response = client.ctap1.device.recv(CTAPHID.MSG)
+    with pytest.raises(ApduError) as e:
+        client.ctap1.parse_response(response)
+    assert e.value.code == APDU.SW_PROPRIETARY_INTERNAL
+
+    # App should then allow new requests
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    registration_data.verify(app_param, challenge)
+
+
 def test_register_raw_u2f_fake_channel_security_crc(client: TestClient):
     if client.use_raw_HID_endpoint:
         pytest.skip("Does not work with this transport")
@@ -327,8 +407,14 @@ def test_register_wrong_p1p2(client: TestClient):
                                    data=data)
         assert e.value.code == APDU.SW_INCORRECT_P1P2
 
-    # Only supported P2 is 0x00
-    for p2 in range(1, 0xff + 1):
+    # Only supported P2 are 0x00 and the proprietary compact key handle request
+    valid_p2 = [
+        0x00,
+        U2F_P2.COMPACT_KEY_HANDLE,
+    ]
+    for p2 in range(0xff + 1):
+        if p2 in valid_p2:
+            continue
         with pytest.raises(ApduError) as e:
             client.ctap1.send_apdu(cla=0x00,
                                    ins=Ctap1.INS.REGISTER,
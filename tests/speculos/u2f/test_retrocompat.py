@@ -1,25 +1,62 @@
-from utils import generate_random_bytes
+import pytest
+
+from fido2.ctap1 import ApduError
 
 from client import TestClient
+from ctap1_client import APDU
+from utils import generate_random_bytes
 
 
-def test_authenticate_ok(client: TestClient):
-    # Make sure that app update will still works with previously generated
-    # key handles and public key already shared with some Relying Party
-    app_param_hex = "f430952043cccefab769aa034f8f38d6"
-    app_param_hex += "9c21d3d685ed7044a3602c4f8901ec73"
-    app_param = bytearray.fromhex(app_param_hex)
+# Make sure that app update will still works with previously generated
+# key handles and public key already shared with some Relying Party
+APP_PARAM_HEX = "f430952043cccefab769aa034f8f38d6"
+APP_PARAM_HEX += "9c21d3d685ed7044a3602c4f8901ec73"
 
-    key_handle_hex = "2a3d03e1045aab9fc7415b5a62a7373c"
-    key_handle_hex += "3282d0e16e3b95e7727139951a993144"
-    key_handle_hex += "2d6d41e817c0cfc1082b37909feca72b"
-    key_handle_hex += "043ddac0c18301f0536bd6df821282eb"
-    key_handle = bytearray.fromhex(key_handle_hex)
+# v1 key handle: nonce | HMAC(app_param | private key)
+KEY_HANDLE_V1_HEX = "2a3d03e1045aab9fc7415b5a62a7373c"
+KEY_HANDLE_V1_HEX += "3282d0e16e3b95e7727139951a993144"
+KEY_HANDLE_V1_HEX += "2d6d41e817c0cfc1082b37909feca72b"
+KEY_HANDLE_V1_HEX += "043ddac0c18301f0536bd6df821282eb"
+
+PUBLIC_KEY_V1_HEX = "0411410f5ca231c9935585190628ad66"
+PUBLIC_KEY_V1_HEX += "ea3577b690c88f7e7ada2d0531b1845d"
+PUBLIC_KEY_V1_HEX += "350c8325f960de51a6938ca45da1d40d"
+PUBLIC_KEY_V1_HEX += "84360c8d50df3633c80920645ccd604f61"
+
+# v2 key handle: 0x02 | nonce | HMAC(0x02 | nonce | app_param)
+KEY_HANDLE_V2_HEX = "02"
+KEY_HANDLE_V2_HEX += "758e462d7b753962038fda459a025ac6"
+KEY_HANDLE_V2_HEX += "ea017c6d120a1ae5fb627317bbcfc8fd"
+KEY_HANDLE_V2_HEX += "035a6c339bd846d786810cedef8f24d6"
+KEY_HANDLE_V2_HEX += "e0771b03fa4bcb77af9ad637888eca05"
+
+PUBLIC_KEY_V2_HEX = "040992dae6bf685ec26375e677754eda"
+PUBLIC_KEY_V2_HEX += "92d2d37e12f314e085f39c87ae19bba0"
+PUBLIC_KEY_V2_HEX += "94929ad9f75dde7ca6ea66cbb0fbb4ae"
+PUBLIC_KEY_V2_HEX += "45b7b9a983292f6d56ac34c33890408c64"
+
+# compact key handle: 0x03 | nonce | truncated HMAC(0x03 | nonce | app_param)
+KEY_HANDLE_COMPACT_HEX = "03"
+KEY_HANDLE_COMPACT_HEX += "34e1617eacb3eb3c33b6435ad4fbcadc"
+KEY_HANDLE_COMPACT_HEX += "ac2bff1094e7114e2c1c8962ca97a2b0"
 
-    public_key_hex = "0411410f5ca231c9935585190628ad66"
-    public_key_hex += "ea3577b690c88f7e7ada2d0531b1845d"
-    public_key_hex += "350c8325f960de51a6938ca45da1d40d"
-    public_key_hex += "84360c8d50df3633c80920645ccd604f61"
+PUBLIC_KEY_COMPACT_HEX = "040babc583514555b70dc9bcb02ba36b"
+PUBLIC_KEY_COMPACT_HEX += "86d237007298b642d677a421104dddce"
+PUBLIC_KEY_COMPACT_HEX += "a182b7f944ad377a9edbd6b5546d1620"
+PUBLIC_KEY_COMPACT_HEX += "7b0bd3b753e79886ec40e68f886c05bb9d"
+
+KEY_HANDLES = {
+    "v1": (KEY_HANDLE_V1_HEX, PUBLIC_KEY_V1_HEX),
+    "v2": (KEY_HANDLE_V2_HEX, PUBLIC_KEY_V2_HEX),
+    "compact": (KEY_HANDLE_COMPACT_HEX, PUBLIC_KEY_COMPACT_HEX),
+}
+
+
+@pytest.mark.parametrize("version", KEY_HANDLES.keys())
+def test_authenticate_ok(client: TestClient, version: str):
+    key_handle_hex, public_key_hex = KEY_HANDLES[version]
+    app_param = bytearray.fromhex(APP_PARAM_HEX)
+    key_handle = bytearray.fromhex(key_handle_hex)
     public_key = bytearray.fromhex(public_key_hex)
 
     challenge = generate_random_bytes(32)
@@ -29,3 +66,50 @@ def test_authenticate_ok(client: TestClient):
                                                     key_handle)
 
     authentication_data.verify(app_param, challenge, public_key)
+
+
+@pytest.mark.parametrize("version", KEY_HANDLES.keys())
+def test_authenticate_wrong_app_param(client: TestClient, version: str):
+    key_handle_hex, _ = KEY_HANDLES[version]
+    app_param = bytearray.fromhex(APP_PARAM_HEX)
+    key_handle = bytearray.fromhex(key_handle_hex)
+
+    # Change app_param last bit
+    app_param[-1] ^= 0x01
+
+    challenge = generate_random_bytes(32)
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  app_param,
+                                  key_handle,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+
+def test_authenticate_v2_wrong_version(client: TestClient):
+    app_param = bytearray.fromhex(APP_PARAM_HEX)
+    key_handle = bytearray.fromhex(KEY_HANDLE_V2_HEX)
+
+    # Unknown version byte, with a valid v2 nonce and signature
+    key_handle[0] = 0x01
+
+    challenge = generate_random_bytes(32)
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.authenticate(challenge,
+                                  app_param,
+                                  key_handle,
+                                  user_accept=None)
+    assert e.value.code == APDU.SW_WRONG_DATA
+
+
+def test_register_generates_v2(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+
+    registration_data = client.ctap1.register(challenge, app_param)
+    registration_data.verify(app_param, challenge)
+
+    assert len(registration_data.key_handle) == 65
+    assert registration_data.key_handle[0] == 0x02
@@ -0,0 +1,88 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU, U2F_INS
+from utils import generate_random_bytes
+
+
+@pytest.fixture(autouse=True)
+def stats_supported(client: TestClient, features: set):
+    require_feature(features, "stats")
+    client.ctap1.reset_stats()
+
+
+def test_stats_requests(client: TestClient):
+    client.ctap1.send_apdu(ins=0x03)
+    with pytest.raises(ApduError):
+        client.ctap1.send_apdu(ins=0x50)
+
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    authentication_data = client.ctap1.authenticate(challenge, app_param,
+                                                    registration_data.key_handle)
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+    stats = client.ctap1.get_stats()
+    requests = stats["requests"]
+
+    # The reset request is the first one counted
+    assert requests[U2F_INS.GET_STATS][APDU.SW_NO_ERROR] == 1
+    assert requests[0x03][APDU.SW_NO_ERROR] == 1
+    assert requests[None][APDU.SW_INS_NOT_SUPPORTED] == 1
+    assert requests[0x01][APDU.SW_NO_ERROR] == 1
+    assert requests[0x02][APDU.SW_NO_ERROR] == 1
+
+    # Each completed request has exactly one latency sample, retries of the
+    # pending request over the U2F endpoint may add prompts
+    total = sum(sum(counts.values()) for counts in requests.values())
+    assert sum(stats["request"]) == total
+    assert sum(stats["parse_to_prompt"]) >= 2
+    assert sum(stats["confirm_to_response"]) == 2
+
+    # The authentication counter was either persisted or served from RAM
+    assert stats["nvm_writes"] + stats["counter_saved_writes"] >= 1
+    assert stats["nvm_bytes"] >= 4 * stats["nvm_writes"]
+
+
+def test_stats_reset(client: TestClient):
+    client.ctap1.send_apdu(ins=0x03)
+    client.ctap1.send_apdu(ins=0x03)
+    assert client.ctap1.get_stats()["requests"][0x03][APDU.SW_NO_ERROR] == 2
+
+    client.ctap1.reset_stats()
+    stats = client.ctap1.get_stats()
+    assert stats["requests"][0x03][APDU.SW_NO_ERROR] == 0
+    assert stats["requests"][U2F_INS.GET_STATS][APDU.SW_NO_ERROR] == 1
+    assert stats["nvm_writes"] == 0
+
+
+def test_stats_user_refused(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    with pytest.raises(ApduError):
+        client.ctap1.register(challenge, app_param, user_accept=False)
+
+    stats = client.ctap1.get_stats()
+    assert stats["requests"][0x01][APDU.SW_PROPRIETARY_INTERNAL] == 1
+    assert sum(stats["confirm_to_response"]) == 1
+
+
+def test_stats_wrong_p1p2(client: TestClient):
+    for p1 in [0x02, 0xff]:
+        with pytest.raises(ApduError) as e:
+            client.ctap1.send_apdu(ins=U2F_INS.GET_STATS, p1=p1)
+        assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_STATS, p2=0x01)
+    assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+
+def test_stats_wrong_length(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_STATS, data=b"\x00")
+    assert e.value.code == APDU.SW_WRONG_LENGTH
@@ -0,0 +1,75 @@
+import pytest
+
+from fido2.ctap1 import ApduError
+
+from client import TestClient
+from conftest import require_feature
+from ctap1_client import APDU, U2F_INS
+from trace_decoder import decode_pages, split_requests
+from utils import generate_random_bytes
+
+
+@pytest.fixture(autouse=True)
+def trace_supported(client: TestClient, features: set):
+    require_feature(features, "trace")
+    client.ctap1.clear_trace()
+
+
+def get_requests(client: TestClient):
+    requests = split_requests(decode_pages(client.ctap1.get_trace_pages()))
+    return [r for r in requests if r["ins"] != U2F_INS.GET_TRACE]
+
+
+def test_trace_authenticate(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    registration_data = client.ctap1.register(challenge, app_param)
+    client.ctap1.clear_trace()
+
+    authentication_data = client.ctap1.authenticate(challenge, app_param,
+                                                    registration_data.key_handle)
+    authentication_data.verify(app_param, challenge, registration_data.public_key)
+
+    requests = [r for r in get_requests(client) if r["ins"] == 0x02]
+    confirmed = [r for r in requests
+                 if any(record.event == "signature_done" for record in r["records"])]
+    assert len(confirmed) == 1
+
+    events = [record.event for record in confirmed[0]["records"]]
+    assert events == ["apdu_received", "length_parsed", "unwrap_done", "key_derived",
+                      "prompt_shown", "user_decision", "signature_done", "reply"]
+    assert confirmed[0]["records"][-1].arg == APDU.SW_NO_ERROR
+
+
+def test_trace_register(client: TestClient):
+    challenge = generate_random_bytes(32)
+    app_param = generate_random_bytes(32)
+    client.ctap1.register(challenge, app_param)
+
+    requests = [r for r in get_requests(client) if r["ins"] == 0x01]
+    events = set(record.event for r in requests for record in r["records"])
+    assert {"prompt_shown", "key_derived", "signature_done", "user_decision"} <= events
+
+
+def test_trace_clear(client: TestClient):
+    client.ctap1.send_apdu(ins=0x03)
+    assert [r["ins"] for r in get_requests(client)] == [0x03]
+
+    client.ctap1.clear_trace()
+    assert get_requests(client) == []
+
+
+def test_trace_wrong_p1p2(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_TRACE, p2=0x02)
+    assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_TRACE, p1=0x01, p2=0x01)
+    assert e.value.code == APDU.SW_INCORRECT_P1P2
+
+
+def test_trace_wrong_length(client: TestClient):
+    with pytest.raises(ApduError) as e:
+        client.ctap1.send_apdu(ins=U2F_INS.GET_TRACE, data=b"\x00")
+    assert e.value.code == APDU.SW_WRONG_LENGTH
@@ -1,5 +1,10 @@
+import json
 import secrets
+import statistics
 import struct
+import time
+
+from pathlib import Path
 
 from fido2.utils import sha256
 
@@ -21,45 +26,41 @@ def generate_random_bytes(length):
     return secrets.token_bytes(length)
 
 
+def measure_latency(func, iterations):
+    samples = []
+    for _ in range(iterations):
+        start = time.perf_counter()
+        func()
+        samples.append(time.perf_counter() - start)
+    return samples
+
+
+def print_latency(name, samples):
+    samples_ms = sorted(x * 1000 for x in samples)
+    p90 = samples_ms[int(0.9 * (len(samples_ms) - 1))]
+    print("{}: n={} min={:.1f}ms median={:.1f}ms p90={:.1f}ms max={:.1f}ms".format(
+          name, len(samples_ms), samples_ms[0], statistics.median(samples_ms),
+          p90, samples_ms[-1]))
+
+
+def ctaphid_frame_count(length, report_size=64):
+    # CTAPHID init frame header: CID (4) | CMD (1) | BCNT (2)
+    # CTAPHID continuation frame header: CID (4) | SEQ (1)
+    init_payload = report_size - 7
+    cont_payload = report_size - 5
+    if length <= init_payload:
+        return 1
+    return 1 + (length - init_payload + cont_payload - 1) // cont_payload
+
+
 def get_rp_id_hash(rp_id):
     return sha256(rp_id.encode("utf8"))
 
 
-# Extracted from src/fido_known_app.c
-fido_known_app = {
-    "apple.com": "Apple",
-    "aws.amazon.com": "Amazon",
-    "binance.com": "Binance",
-    "www.binance.com": "Binance",
-    "https://bitbucket.org": "Bitbucket",
-    "https://www.bitfinex.com": "Bitfinex",
-    "https://vault.bitwarden.com/app-id.json": "Bitwarden",
-    "coinbase.com": "Coinbase",
-    "https://www.dashlane.com": "Dashlane",
-    "https://www.dropbox.com/u2f-app-id.json": "Dropbox",
-    "www.dropbox.com": "Dropbox",
-    "https://api-9dcf9b83.duosecurity.com": "Duo",
-    "facebook.com": "Facebook",
-    "https://www.fastmail.com": "FastMail",
-    "https://id.fedoraproject.org/u2f-origins.json": "Fedora",
-    "https://account.gandi.net/api/u2f/trusted_facets.json": "Gandi",
-    "github.com": "Github",
-    "https://github.com/u2f/trusted_facets": "GitHub",
-    "https://gitlab.com": "GitLab",
-    "google.com": "Google",
-    "https://www.gstatic.com/securitykey/origins.json": "Google",
-    "https://keepersecurity.com": "Keeper",
-    "kraken.com": "Kraken",
-    "https://lastpass.com": "LastPass",
-    "login.microsoft.com": "Microsoft",
-    "https://slushpool.com/static/security/u2f.json": "Slush Pool",
-    "https://dashboard.stripe.com": "Stripe",
-    "https://u2f.bin.coffee": "u2f.bin.coffee",
-    "webauthn.bin.coffee": "webauthn.bin.coffee",
-    "webauthn.io": "WebAuthn.io",
-    "webauthn.me": "WebAuthn.me",
-    "demo.yubico.com": "demo.yubico.com",
-}
+# Same source as the table generated in include/fido_known_apps_db.h
+KNOWN_APPS_PATH = Path(__file__).parent.parent.parent / "known_apps" / "known_apps.json"
+with open(KNOWN_APPS_PATH, "r") as f:
+    fido_known_app = {x["id"]: x["name"] for x in json.load(f)}
 fido_known_appid = {get_rp_id_hash(x): y for x, y in fido_known_app.items()}
 
 